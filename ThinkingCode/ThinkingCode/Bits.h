@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+//Bit operations on 64-bit words. std::popcount and its relatives need C++20, these also work with C++17 and
+//compile to the same instructions on GCC and Clang
+
+namespace Bits
+{
+
+   //! \brief Returns the number of set bits
+   inline int PopCount( uint64_t bits )
+   {
+#if defined( __GNUC__ ) || defined( __clang__ )
+      return __builtin_popcountll( bits );
+#else
+      //Sums the bits of pairs, then of nibbles, and adds up the bytes in the top byte of the product
+      bits = bits - ( ( bits >> 1 ) & 0x5555555555555555ull );
+      bits = ( bits & 0x3333333333333333ull ) + ( ( bits >> 2 ) & 0x3333333333333333ull );
+      bits = ( bits + ( bits >> 4 ) ) & 0x0f0f0f0f0f0f0f0full;
+      return static_cast<int>( ( bits * 0x0101010101010101ull ) >> 56 );
+#endif
+   }
+
+   //! \brief Returns the number of zero bits below the lowest set bit, 64 for zero
+   inline int CountTrailingZeros( uint64_t bits )
+   {
+      if ( bits == 0 ) return 64;
+#if defined( __GNUC__ ) || defined( __clang__ )
+      return __builtin_ctzll( bits );
+#else
+      //The bits below the lowest set bit are the set bits of one less than the lowest set bit alone
+      return PopCount( ( bits & ( ~bits + 1 ) ) - 1 );
+#endif
+   }
+
+   //! \brief Returns the number of zero bits above the highest set bit, 64 for zero
+   inline int CountLeadingZeros( uint64_t bits )
+   {
+      if ( bits == 0 ) return 64;
+#if defined( __GNUC__ ) || defined( __clang__ )
+      return __builtin_clzll( bits );
+#else
+      //Sets all bits below the highest set bit, the zeros above it remain
+      bits |= bits >> 1;
+      bits |= bits >> 2;
+      bits |= bits >> 4;
+      bits |= bits >> 8;
+      bits |= bits >> 16;
+      bits |= bits >> 32;
+      return 64 - PopCount( bits );
+#endif
+   }
+
+}
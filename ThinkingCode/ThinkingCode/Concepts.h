@@ -9,4 +9,4 @@ struct _Voidifyer
 };
 
 template<typename... Args>
-using void_t = _Voidifyer<Args...>::type;
\ No newline at end of file
+using void_t = typename _Voidifyer<Args...>::type;
\ No newline at end of file
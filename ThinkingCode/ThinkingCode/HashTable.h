@@ -0,0 +1,557 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Containers
+{
+
+   //! \brief Append-only storage that allocates its elements in blocks
+   //!
+   //! Elements never move once they are created, so pointers to them stay valid until the arena is
+   //! destroyed. Blocks grow geometrically up to MaxBlockSize elements
+   //! \tparam _ValType Type of the elements
+   template<typename _ValType>
+   class Arena
+   {
+      struct _Block
+      {
+         _ValType* data;
+         size_t count;
+         size_t capacity;
+      };
+   public:
+      class const_iterator : public std::iterator<std::forward_iterator_tag, _ValType, ptrdiff_t, const _ValType*, const _ValType&>
+      {
+      public:
+         const_iterator( const _Block* block, size_t offset ) :
+            _block( block ),
+            _offset( offset )
+         {
+         }
+
+         const _ValType& operator*( ) const
+         {
+            return _block->data[_offset];
+         }
+
+         const _ValType* operator->( ) const
+         {
+            return &_block->data[_offset];
+         }
+
+         const_iterator& operator++( )
+         {
+            //Only the last block can be partially filled, so a block is never empty
+            if ( ++_offset == _block->count )
+            {
+               ++_block;
+               _offset = 0;
+            }
+            return *this;
+         }
+
+         bool operator==( const const_iterator& other ) const
+         {
+            return _block == other._block && _offset == other._offset;
+         }
+
+         bool operator!=( const const_iterator& other ) const
+         {
+            return !operator==( other );
+         }
+      private:
+         const _Block* _block;
+         size_t _offset;
+      };
+
+      enum : size_t
+      {
+         //! Number of elements in the first block
+         MinBlockSize = 16,
+         //! Maximum number of elements per block
+         MaxBlockSize = 4096
+      };
+
+      Arena() :
+         _size( 0 )
+      {
+      }
+
+      Arena( Arena&& other ) :
+         _blocks( std::move( other._blocks ) ),
+         _size( other._size )
+      {
+         other._blocks.clear();
+         other._size = 0;
+      }
+
+      Arena& operator=( Arena&& other )
+      {
+         if ( this == &other ) return *this;
+         Clear();
+         _blocks = std::move( other._blocks );
+         _size = other._size;
+         other._blocks.clear();
+         other._size = 0;
+         return *this;
+      }
+
+      Arena( const Arena& ) = delete;
+      Arena& operator=( const Arena& ) = delete;
+
+      ~Arena()
+      {
+         Clear();
+      }
+
+      //! \brief Creates a new element at the end of the arena
+      //! \param args Arguments for the constructor of the element
+      //! \returns The new element
+      template<typename... _Args>
+      _ValType& Emplace( _Args&&... args )
+      {
+         if ( _blocks.empty() || _blocks.back().count == _blocks.back().capacity )
+         {
+            size_t capacity = _blocks.empty() ? MinBlockSize : std::min( _blocks.back().capacity * 2, size_t( MaxBlockSize ) );
+            auto data = static_cast<_ValType*>( ::operator new( capacity * sizeof( _ValType ) ) );
+            _blocks.push_back( _Block{ data, 0, capacity } );
+         }
+
+         auto& block = _blocks.back();
+         auto element = new ( block.data + block.count ) _ValType( std::forward<_Args>( args )... );
+         ++block.count;
+         ++_size;
+         return *element;
+      }
+
+      //! \brief Destroys all elements and releases the memory of the arena
+      void Clear()
+      {
+         for ( auto& block : _blocks )
+         {
+            for ( size_t i = 0; i < block.count; i++ ) block.data[i].~_ValType();
+            ::operator delete( block.data );
+         }
+         _blocks.clear();
+         _size = 0;
+      }
+
+      size_t size() const
+      {
+         return _size;
+      }
+
+      const_iterator begin() const
+      {
+         return const_iterator( _blocks.data(), 0 );
+      }
+
+      const_iterator end() const
+      {
+         return const_iterator( _blocks.data() + _blocks.size(), 0 );
+      }
+   private:
+      std::vector<_Block> _blocks;
+      size_t _size;
+   };
+
+   //! \brief Mixes a hash, so that keys with similar hashes, e.g. consecutive integers, spread over the whole
+   //!        table
+   inline size_t _MixHash( size_t hash )
+   {
+      uint64_t mixed = static_cast<uint64_t>( hash ) * 0x9E3779B97F4A7C15ull;
+      return static_cast<size_t>( mixed ^ ( mixed >> 32 ) );
+   }
+
+   //! \brief Hash table with open addressing that stores its entries in an arena
+   //!
+   //! The slots of the table only hold the hash of a key and a pointer to its entry, so probing touches a small,
+   //! contiguous array and growing the table does not move any entry. Collisions are resolved by linear probing.
+   //! Entries are iterated in the order in which their keys were inserted
+   //! \tparam _Key Type of the keys
+   //! \tparam _Val Type of the values
+   //! \tparam _Hash Hash function for the keys
+   //! \tparam _Eq Equality comparison for the keys
+   template<typename _Key,
+            typename _Val,
+            typename _Hash = std::hash<_Key>,
+            typename _Eq = std::equal_to<_Key>>
+   class HashTable
+   {
+   public:
+      using key_type = _Key;
+      using mapped_type = _Val;
+      using value_type = std::pair<const _Key, _Val>;
+      using const_iterator = typename Arena<value_type>::const_iterator;
+      using iterator = const_iterator;
+
+      explicit HashTable( const _Hash& hash = _Hash(), const _Eq& eq = _Eq() ) :
+         _hash( hash ),
+         _eq( eq )
+      {
+      }
+
+      HashTable( HashTable&& other ) = default;
+      HashTable& operator=( HashTable&& other ) = default;
+      HashTable( const HashTable& ) = delete;
+      HashTable& operator=( const HashTable& ) = delete;
+
+      //! \brief Returns the value of the given key, inserting it with the given initial value if it does not exist
+      //! \param key The key
+      //! \param init Value of a newly inserted key
+      //! \returns The value of the key
+      _Val& FindOrInsert( const _Key& key, const _Val& init )
+      {
+         Reserve();
+         size_t hash = Hash( key );
+         auto& slot = _slots[Probe( key, hash )];
+         if ( !slot.entry ) Insert( slot, hash, key, init );
+         return slot.entry->second;
+      }
+
+      //! \brief Returns the value of the given key, or null if it does not exist
+      const _Val* Find( const _Key& key ) const
+      {
+         if ( _slots.empty() ) return nullptr;
+         auto& slot = _slots[Probe( key, Hash( key ) )];
+         return slot.entry ? &slot.entry->second : nullptr;
+      }
+
+      _Val* Find( const _Key& key )
+      {
+         return const_cast<_Val*>( static_cast<const HashTable*>( this )->Find( key ) );
+      }
+
+      bool Contains( const _Key& key ) const
+      {
+         return Find( key ) != nullptr;
+      }
+
+      //! \brief Moves all entries of the other table into this table
+      //! \param other The table to merge into this table, is empty afterwards
+      //! \param merge Called as merge( value, otherValue ) for each key that exists in both tables, has to
+      //!              combine otherValue into value
+      template<typename _MergeFn>
+      void Merge( HashTable&& other, _MergeFn merge )
+      {
+         for ( auto& entry : other._entries )
+         {
+            //The arena only hands out const entries, but the entries of the other table are not const
+            auto& otherEntry = const_cast<value_type&>( entry );
+            Reserve();
+            size_t hash = Hash( otherEntry.first );
+            auto& slot = _slots[Probe( otherEntry.first, hash )];
+            if ( slot.entry )
+            {
+               merge( slot.entry->second, std::move( otherEntry.second ) );
+            }
+            else
+            {
+               Insert( slot, hash, otherEntry.first, std::move( otherEntry.second ) );
+            }
+         }
+         other._entries.Clear();
+         other._slots.clear();
+      }
+
+      size_t size() const
+      {
+         return _entries.size();
+      }
+
+      bool empty() const
+      {
+         return _entries.size() == 0;
+      }
+
+      const_iterator begin() const
+      {
+         return _entries.begin();
+      }
+
+      const_iterator end() const
+      {
+         return _entries.end();
+      }
+   private:
+      struct _Slot
+      {
+         size_t hash;
+         value_type* entry;
+      };
+
+      size_t Hash( const _Key& key ) const
+      {
+         return _MixHash( _hash( key ) );
+      }
+
+      //! \brief Makes sure that there is a free slot for one more entry
+      void Reserve()
+      {
+         //Keep at most 3/4 of the slots occupied, so that probe sequences stay short
+         if ( ( _entries.size() + 1 ) * 4 > _slots.size() * 3 ) Grow();
+      }
+
+      //! \brief Returns the index of the slot of the given key, or of the empty slot where it would be inserted
+      size_t Probe( const _Key& key, size_t hash ) const
+      {
+         size_t mask = _slots.size() - 1;
+         for ( size_t pos = hash & mask; ; pos = ( pos + 1 ) & mask )
+         {
+            auto& slot = _slots[pos];
+            if ( !slot.entry ) return pos;
+            if ( slot.hash == hash && _eq( slot.entry->first, key ) ) return pos;
+         }
+      }
+
+      template<typename _ValArg>
+      void Insert( _Slot& slot, size_t hash, const _Key& key, _ValArg&& val )
+      {
+         slot.hash = hash;
+         slot.entry = &_entries.Emplace( key, std::forward<_ValArg>( val ) );
+      }
+
+      //! \brief Doubles the number of slots. Only the slots are moved, the entries stay where they are
+      void Grow()
+      {
+         std::vector<_Slot> slots( std::max( _slots.size() * 2, size_t( 16 ) ), _Slot{ 0, nullptr } );
+         size_t mask = slots.size() - 1;
+         for ( auto& slot : _slots )
+         {
+            if ( !slot.entry ) continue;
+            size_t pos = slot.hash & mask;
+            while ( slots[pos].entry ) pos = ( pos + 1 ) & mask;
+            slots[pos] = slot;
+         }
+         _slots.swap( slots );
+      }
+
+      _Hash _hash;
+      _Eq _eq;
+      std::vector<_Slot> _slots;
+      Arena<value_type> _entries;
+   };
+
+   //! \brief Set with open addressing that stores its keys directly in the slots
+   //!
+   //! In contrast to HashTable, there is no indirection, so inserting or finding a key usually touches a single
+   //! cache line. Growing the set moves the keys, so they have to be default constructible and movable.
+   //! Collisions are resolved by linear probing
+   //! \tparam _Key Type of the keys
+   //! \tparam _Hash Hash function for the keys
+   //! \tparam _Eq Equality comparison for the keys
+   template<typename _Key,
+            typename _Hash = std::hash<_Key>,
+            typename _Eq = std::equal_to<_Key>>
+   class HashSet
+   {
+   public:
+      explicit HashSet( const _Hash& hash = _Hash(), const _Eq& eq = _Eq() ) :
+         _hash( hash ),
+         _eq( eq ),
+         _size( 0 )
+      {
+      }
+
+      //! \brief Mixed hash of the key, as it is used by the set. Never zero, zero marks an empty slot
+      size_t Hash( const _Key& key ) const
+      {
+         size_t hash = _MixHash( _hash( key ) );
+         return hash ? hash : 1;
+      }
+
+      //! \brief Inserts the key if it is not in the set yet
+      //! \returns True if the key was inserted
+      bool Insert( const _Key& key )
+      {
+         return Insert( key, Hash( key ) );
+      }
+
+      //! \brief Inserts the key if it is not in the set yet
+      //! \param key The key
+      //! \param hash Hash of the key, as returned by Hash
+      //! \returns True if the key was inserted
+      bool Insert( const _Key& key, size_t hash )
+      {
+         Reserve( _size + 1 );
+         auto& slot = _slots[Probe( key, hash )];
+         if ( slot.hash ) return false;
+         Store( slot, hash, key );
+         return true;
+      }
+
+      //! \brief Inserts a key that is known not to be in the set, e.g. because a BloomFilter said so. This
+      //!        only looks for a free slot, without comparing any keys
+      //! \param key The key
+      //! \param hash Hash of the key, as returned by Hash
+      void InsertNew( const _Key& key, size_t hash )
+      {
+         Reserve( _size + 1 );
+         size_t mask = _slots.size() - 1;
+         size_t pos = hash & mask;
+         while ( _slots[pos].hash ) pos = ( pos + 1 ) & mask;
+         Store( _slots[pos], hash, key );
+      }
+
+      bool Contains( const _Key& key ) const
+      {
+         return !_slots.empty() && _slots[Probe( key, Hash( key ) )].hash != 0;
+      }
+
+      //! \brief Makes room for the given number of keys, so that inserting them does not grow the set
+      void Reserve( size_t count )
+      {
+         //Keep at most 3/4 of the slots occupied, so that probe sequences stay short
+         if ( count * 4 <= _slots.size() * 3 ) return;
+         size_t slots = std::max( _slots.size(), size_t( 16 ) );
+         while ( count * 4 > slots * 3 ) slots *= 2;
+         Rehash( slots );
+      }
+
+      size_t size() const
+      {
+         return _size;
+      }
+
+      bool empty() const
+      {
+         return _size == 0;
+      }
+   private:
+      struct _Slot
+      {
+         size_t hash;
+         _Key key;
+      };
+
+      //! \brief Returns the index of the slot of the given key, or of the empty slot where it would be inserted
+      size_t Probe( const _Key& key, size_t hash ) const
+      {
+         size_t mask = _slots.size() - 1;
+         for ( size_t pos = hash & mask; ; pos = ( pos + 1 ) & mask )
+         {
+            auto& slot = _slots[pos];
+            if ( !slot.hash ) return pos;
+            if ( slot.hash == hash && _eq( slot.key, key ) ) return pos;
+         }
+      }
+
+      void Store( _Slot& slot, size_t hash, const _Key& key )
+      {
+         slot.hash = hash;
+         slot.key = key;
+         ++_size;
+      }
+
+      //! \brief Moves the keys into the given number of slots
+      void Rehash( size_t count )
+      {
+         std::vector<_Slot> slots( count );
+         size_t mask = count - 1;
+         for ( auto& slot : _slots )
+         {
+            if ( !slot.hash ) continue;
+            size_t pos = slot.hash & mask;
+            while ( slots[pos].hash ) pos = ( pos + 1 ) & mask;
+            slots[pos].hash = slot.hash;
+            slots[pos].key = std::move( slot.key );
+         }
+         _slots.swap( slots );
+      }
+
+      _Hash _hash;
+      _Eq _eq;
+      std::vector<_Slot> _slots;
+      size_t _size;
+   };
+
+   //! \brief Probabilistic set of hashes, which can say that a hash was definitely not added
+   //!
+   //! The filter is split into blocks of one cache line, each hash only sets and tests bits within a single
+   //! block. This costs a slightly higher false positive rate than a plain Bloom filter, but each lookup touches
+   //! only one cache line. Meant to be used in front of a HashSet, whose Hash it expects
+   class BloomFilter
+   {
+   public:
+      //! \brief Creates an empty filter
+      //! \param expectedCount Number of hashes that are expected to be added
+      //! \param falsePositiveRate Probability that MayContain returns true for a hash that was not added, once
+      //!                          expectedCount hashes were added, between 0 and 1 exclusive
+      BloomFilter( size_t expectedCount, double falsePositiveRate )
+      {
+         //Written so that NaN is rejected as well. A rate of 0 would need infinitely many bits
+         if ( !( falsePositiveRate > 0.0 && falsePositiveRate < 1.0 ) ) throw std::runtime_error( "False positive rate must be between 0 and 1" );
+         //Optimal size of a plain Bloom filter, m = -n ln p / ( ln 2 )^2, and number of bits per hash, m / n ln 2
+         double count = static_cast<double>( std::max( expectedCount, size_t( 1 ) ) );
+         double bits = -count * std::log( falsePositiveRate ) / ( std::log( 2.0 ) * std::log( 2.0 ) );
+         size_t blocks = 1;
+         while ( blocks * BlockBits < bits ) blocks *= 2;
+         double hashCount = std::round( bits / count * std::log( 2.0 ) );
+         _hashCount = static_cast<unsigned>( std::min( std::max( hashCount, 1.0 ), 16.0 ) );
+         _mask = blocks - 1;
+         _words.assign( blocks * BlockWords, 0 );
+      }
+
+      void Add( size_t hash )
+      {
+         uint64_t* block = &_words[BlockStart( hash )];
+         uint32_t first, step;
+         Probes( hash, first, step );
+         for ( unsigned i = 0; i < _hashCount; i++, first += step )
+         {
+            unsigned bit = first & ( BlockBits - 1 );
+            block[bit / 64] |= uint64_t( 1 ) << ( bit % 64 );
+         }
+      }
+
+      //! \brief Returns false if the hash was definitely not added, true if it probably was
+      bool MayContain( size_t hash ) const
+      {
+         const uint64_t* block = &_words[BlockStart( hash )];
+         uint32_t first, step;
+         Probes( hash, first, step );
+         for ( unsigned i = 0; i < _hashCount; i++, first += step )
+         {
+            unsigned bit = first & ( BlockBits - 1 );
+            if ( !( block[bit / 64] & ( uint64_t( 1 ) << ( bit % 64 ) ) ) ) return false;
+         }
+         return true;
+      }
+   private:
+      enum : size_t
+      {
+         //! Bits per block, one cache line
+         BlockBits = 512,
+         BlockWords = BlockBits / 64
+      };
+
+      //! \brief Index of the first word of the block of the hash. The low bits of the hash select the slot in a
+      //!        HashSet, so the block is selected by the high bits of the hash mixed once more
+      size_t BlockStart( size_t hash ) const
+      {
+         uint64_t mixed = static_cast<uint64_t>( hash ) * 0xC2B2AE3D27D4EB4Full;
+         return static_cast<size_t>( ( mixed >> 32 ) & _mask ) * BlockWords;
+      }
+
+      //! \brief The bits within the block are selected by double hashing
+      static void Probes( size_t hash, uint32_t& first, uint32_t& step )
+      {
+         uint64_t mixed = static_cast<uint64_t>( hash ) * 0x165667B19E3779F9ull;
+         first = static_cast<uint32_t>( mixed >> 32 );
+         step = static_cast<uint32_t>( mixed ) | 1;
+      }
+
+      std::vector<uint64_t> _words;
+      size_t _mask;
+      unsigned _hashCount;
+   };
+
+}
@@ -1,15 +1,59 @@
 #pragma once
 
+#include "Bits.h"
+#include "Concepts.h"
+#include "HashTable.h"
+#include "Sketches.h"
+#include "SpscQueue.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#ifdef LAZY_INSTRUMENTATION
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#endif
+
+//Dereferencing an end iterator throws if LAZY_CHECKED_ITERATION is 1. With 0, the operations whose end check is
+//a plain comparison leave it out, so that the innermost loops have no branch into the exception handling. By
+//default, iteration is checked unless NDEBUG is defined, i.e. in debug builds. The value has to be the same in
+//all translation units of a program
+#ifndef LAZY_CHECKED_ITERATION
+#ifdef NDEBUG
+#define LAZY_CHECKED_ITERATION 0
+#else
+#define LAZY_CHECKED_ITERATION 1
+#endif
+#endif
+
 namespace Lazy
 {
 
+   //! \brief True if dereferencing an end iterator throws, see LAZY_CHECKED_ITERATION
+   constexpr bool CheckedIteration = LAZY_CHECKED_ITERATION != 0;
+
    template<typename _Val> using _Pred = std::function<bool( const _Val& )>;
    template<typename _Src, typename _Dst> using _Map = std::function<_Dst( const _Src& )>;
 
+   //! \brief Result type of calling a map function of type _Fn with an element of type _Src
+   template<typename _Fn, typename _Src> using _MapResult = typename std::decay<decltype( std::declval<const _Fn&>()( std::declval<const _Src&>() ) )>::type;
+
    template<typename T>
    struct Optional
    {
@@ -29,7 +73,9 @@ namespace Lazy
       }
 
       Optional( const Optional& ) = default;
+      Optional( Optional&& ) = default;
       Optional& operator=( const Optional& ) = default;
+      Optional& operator=( Optional&& ) = default;
 
       operator bool() const
       {
@@ -44,462 +90,4500 @@ namespace Lazy
       Optional( T&& val ) : exists( true ), val( std::move(val) ) {}
    };
 
-#pragma region LazyOperations
+#pragma region SourceAccess
 
-   //! \brief Lazy iterator that implements a filter operation
-   //! \tparam _ValType Value type of the iterator
+   //! \brief Whether the iterator points into contiguous memory. Pointers and vector iterators are detected,
+   //!        all other iterators are treated as non-contiguous
+   template<typename _Iter,
+            typename _Val = typename std::iterator_traits<_Iter>::value_type>
+   struct _IsContiguous : std::integral_constant<bool, std::is_pointer<_Iter>::value ||
+                                                      std::is_same<_Iter, typename std::vector<_Val>::iterator>::value ||
+                                                      std::is_same<_Iter, typename std::vector<_Val>::const_iterator>::value>
+   {
+   };
+
+   //! \brief vector<bool> is not stored contiguously
+   template<typename _Iter>
+   struct _IsContiguous<_Iter, bool> : std::false_type
+   {
+   };
+
+   //! \brief Gives access to the source iterators at the bottom of a chain of lazy operations
+   //!
+   //! Lazy operations nest either the iterators of the source container or another lazy operation. This
+   //! is the version for the iterators of the source container, nested lazy operations are handled by the
+   //! specialization below
    //! \tparam _Iter Type of the nested iterator
-   template<typename _ValType,
-            typename _Iter>
-   class LazyFilter : public std::iterator<std::forward_iterator_tag, _ValType>
+   template<typename _Iter, typename = void>
+   struct _SourceAccess
    {
-   public:
-      using _IterType = LazyFilter;
+      using _SourceIter = _Iter;
 
-      LazyFilter( _Iter start,
-                  _Iter end, 
-                  _Iter cur,
-                  const _Pred<_ValType>& pred ) :
-         _begin( start ),
-         _end( end ),
-         _cur( cur ),
-         _pred( pred )
+      //! \brief Whether a chain over this source can be split into chunks that are evaluated independently
+      using _Splittable = std::integral_constant<bool, std::is_base_of<std::random_access_iterator_tag,
+                                                                       typename std::iterator_traits<_Iter>::iterator_category>::value>;
+
+      //! \brief Whether the size of a range over this source is known exactly and in constant time
+      using _SizeKnown = _Splittable;
+
+      //! \brief Whether a chain over this source can be evaluated in blocks of arithmetic values
+      using _Vectorizable = std::integral_constant<bool, _IsContiguous<_Iter>::value &&
+                                                        std::is_arithmetic<typename std::iterator_traits<_Iter>::value_type>::value>;
+
+      //! \brief Upper bound on the number of elements, in constant time if the source is random access
+      static size_t SizeHint( const _Iter& begin, const _Iter& end )
       {
+         return SizeHint( begin, end, typename std::iterator_traits<_Iter>::iterator_category() );
       }
 
-      LazyFilter( const LazyFilter& other ) :
-         _begin( other._begin ),
-         _end( other._end ),
-         _cur( other._cur ),
-         _pred( other._pred )
+      static size_t SizeHint( const _Iter& begin, const _Iter& end, std::forward_iterator_tag )
       {
+         return static_cast<size_t>( std::distance( begin, end ) );
       }
 
-      LazyFilter& operator++(  )
+      //! \brief Input iterators can only be traversed once, so there is no bound without consuming them
+      static size_t SizeHint( const _Iter&, const _Iter&, std::input_iterator_tag )
       {
-         //Filter skips elements, so we always increment to the next element that matches the predicate
-         //or to the end
-         if ( _cur == _end ) return *this;
-         //Skip all elements that don't match the predicate
-         do
-         {
-            ++_cur;
-         }
-         while ( _cur != _end && 
-                  !_pred( *_cur ) );
-         return *this;
+         return ~size_t( 0 );
       }
 
-      _ValType operator*( ) const
+      //! \brief Evaluates a block of source elements. There is nothing to evaluate for the source itself,
+      //!        so this returns the source elements without copying them
+      //! \param src The source elements
+      //! \param count Number of source elements
+      //! \param resultCount Receives the number of resulting elements
+      //! \returns Pointer to the resulting elements
+      template<typename _Val>
+      static const _Val* EvalBlock( const _Iter&, const _Val* src, size_t count, _Val*, size_t& resultCount )
       {
-         if ( _cur == _end ) throw std::exception( "Dereferencing end iterator!" );
-         return *_cur;
+         resultCount = count;
+         return src;
       }
 
-      bool operator==( const LazyFilter& other ) const
+      //! \brief Pushes all source elements into the sink. This is the loop that drives a push evaluation
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      static bool Push( const _Iter& begin, const _Iter& end, _Sink& sink )
       {
-         return _cur == other._cur &&
-                  _begin == other._begin &&
-                  _end == other._end; //TODO Ideally we would also compare the predicate
+         for ( auto cur = begin; cur != end; ++cur )
+         {
+            if ( !sink( *cur ) ) return false;
+         }
+         return true;
       }
-      
-      bool operator!=( const LazyFilter& other ) const
+
+      static _SourceIter Begin( const _Iter& begin, const _Iter& )
       {
-         return !operator==( other );
+         return begin;
       }
 
-      bool IsAtEnd() const
+      static _SourceIter End( const _Iter&, const _Iter& end )
       {
-         return _cur == _end;
+         return end;
       }
 
-      LazyFilter begin( ) const
+      //! \brief Returns the iterator to the first element of the nested range
+      static _Iter First( const _Iter& begin )
       {
-         //Move to the first valid element
-         auto begin = _begin;
-         while ( begin != _end &&
-                  !_pred( *begin ) )
-         {
-            ++begin;
-         }
-         return LazyFilter( _begin, _end, begin, _pred );
+         return begin;
       }
 
-      LazyFilter end( ) const
+      //! \brief Returns the begin and end iterators for the given subrange of the source
+      static std::pair<_Iter, _Iter> Rebase( const _Iter&, _SourceIter first, _SourceIter last )
       {
-         return LazyFilter( _begin, _end, _end, _pred );
+         return std::make_pair( first, last );
       }
-   private:
-      const _Iter _begin;
-      const _Iter _end;
-      _Iter _cur;
-      const _Pred<_ValType> _pred;
    };
 
-   //! \brief Lazy iterator that implements a map operation
-   //! \tparam _SrcType Source type of the map operation
-   //! \tparam _DstType Destination type of the map operation
-   //! \tparam _Iter Type of the nested iterator
-   template<typename _SrcType,
-            typename _DstType,
-            typename _Iter>
-   class LazyMap : public std::iterator<std::forward_iterator_tag, _DstType>
+   template<typename _Iter>
+   struct _SourceAccess<_Iter, void_t<typename _Iter::_SourceIterType>>
    {
-   public:
-      using _IterType = LazyMap;
+      using _SourceIter = typename _Iter::_SourceIterType;
+      using _Splittable = typename _Iter::_Splittable;
+      using _SizeKnown = typename _Iter::_SizeKnown;
+      using _Vectorizable = typename _Iter::_Vectorizable;
 
-      LazyMap( _Iter begin, 
-               _Iter end, 
-               _Iter cur, 
-               const _Map<_SrcType, _DstType>& map ) :
-         _begin( begin ),
-         _end( end ),
-         _cur( cur ),
-         _map( map )
+      static size_t SizeHint( const _Iter& begin, const _Iter& )
       {
+         return begin.SizeHint();
       }
 
-      LazyMap( const LazyMap& other ) :
-         _begin( other._begin ),
-         _end( other._end ),
-         _cur( other._cur ),
-         _map( other._map )
+      //! \brief Evaluates the nested lazy operation on a block of source elements
+      //! \param src The source elements
+      //! \param count Number of source elements
+      //! \param buffer Receives the resulting elements, has to hold at least count elements
+      //! \param resultCount Receives the number of resulting elements
+      //! \returns Pointer to the resulting elements
+      template<typename _SrcVal, typename _Val>
+      static const _Val* EvalBlock( const _Iter& begin, const _SrcVal* src, size_t count, _Val* buffer, size_t& resultCount )
       {
+         resultCount = begin.EvalBlock( src, count, buffer );
+         return buffer;
       }
 
-      LazyMap& operator++( )
+      template<typename _Sink>
+      static bool Push( const _Iter& begin, const _Iter&, _Sink& sink )
       {
-         //Map does not skip elements, so the increment operator is simple
-         if ( _cur != _end ) ++_cur;
-         return *this;
+         return begin.Push( sink );
       }
 
-      _DstType operator*( ) const
+      static _SourceIter Begin( const _Iter& begin, const _Iter& )
       {
-         if ( _cur == _end ) throw std::exception( "Dereferencing end iterator!" );
-         return _map( *_cur );
+         return begin.SourceBegin();
       }
 
-      bool operator==( const LazyMap& other ) const
+      static _SourceIter End( const _Iter& begin, const _Iter& )
       {
-         return _begin == other._begin && 
-                _end == other._end && 
-                _cur == other._cur;
+         return begin.SourceEnd();
       }
 
-      bool operator!=( const LazyMap& other ) const
+      //! \brief Nested lazy operations are stored without evaluating any element, so that e.g. a nested filter
+      //!        is only evaluated once the range is iterated. This evaluates up to the first element
+      static _Iter First( const _Iter& begin )
       {
-         return !operator==( other );
+         return begin.begin();
       }
 
-      bool IsAtEnd() const
+      static std::pair<_Iter, _Iter> Rebase( const _Iter& begin, _SourceIter first, _SourceIter last )
       {
-         return _cur == _end;
+         auto nested = begin.Rebase( first, last );
+         return std::make_pair( nested, nested.end() );
       }
+   };
 
-      LazyMap begin() const
+   //! \brief Position of an operation in its nested range
+   //!
+   //! Iterators of a source, e.g. a container, need the end of the source to know where it ends, so the
+   //! operation directly above the source keeps its bounds along with the position
+   //! \tparam _Iter Type of the nested iterator
+   template<typename _Iter, typename = void>
+   struct _Nested
+   {
+      _Nested( _Iter begin, _Iter end, _Iter cur ) :
+         cur( cur ),
+         _begin( begin ),
+         _end( end )
       {
-         return LazyMap( _begin, _end, _begin, _map );
       }
 
-      LazyMap end() const
+      //! \brief Returns the same range at another position
+      _Nested At( _Iter pos ) const
+      {
+         return _Nested( _begin, _end, pos );
+      }
+
+      bool AtEnd() const
+      {
+         return cur == _end;
+      }
+
+      _Iter Begin() const
+      {
+         return _begin;
+      }
+
+      _Iter End() const
       {
-         return LazyMap( _begin, _end, _end, _map );
+         return _end;
       }
+
+      _Iter cur;
    private:
-      const _Iter _begin;
-      const _Iter _end;
-      _Iter _cur;
-      const _Map<_SrcType, _DstType> _map;
+      _Iter _begin;
+      _Iter _end;
    };
 
-   //! \brief Lazy iterator that is limited to a specific number of elements
-   //! \tparam _ValType Value type of the iterator
-   //! \tparam _Iter Type of the nested iterator
-   template<typename _ValType,
-            typename _Iter>
-   class LazyLimit : public std::iterator<std::forward_iterator_tag, _ValType>
+   //! \brief Lazy operations know their own begin and end, so above them the position is all there is. An
+   //!        iterator of a chain of operations therefore only holds the bounds of the source once
+   template<typename _Iter>
+   struct _Nested<_Iter, void_t<typename _Iter::_SourceIterType>>
    {
-   public:
-      using _IterType = LazyLimit;
-
-      LazyLimit( _Iter begin, _Iter end, _Iter cur, size_t idx, size_t limit ) :
-         _begin( begin ),
-         _end( end ),
-         _cur( cur ),
-         _index( idx ),
-         _limit( limit )
+      _Nested( _Iter, _Iter, _Iter cur ) :
+         cur( cur )
       {
       }
 
-      LazyLimit(const LazyLimit& other) = default;
-      LazyLimit& operator=( const LazyLimit& ) = default;
+      _Nested At( _Iter pos ) const
+      {
+         return _Nested( pos, pos, pos );
+      }
 
-      _ValType operator*( ) const
+      bool AtEnd() const
       {
-         if ( _index == _limit ||
-              _cur == _end )
-         {
-            throw std::exception("Dereferencing end iterator!");
-         }
-         return *_cur;
+         return cur.IsAtEnd();
       }
 
-      LazyLimit& operator++( )
+      _Iter Begin() const
       {
-         if ( _index != _limit &&
-              _cur != _end )
-         {
-            ++_cur;
-            ++_index;
-            if ( _cur == _end )
-            {
-               _index = _limit;
-            }
-            else if ( _index == _limit )
-            {
-               while ( _cur != _end ) ++_cur; //So that comparison with end() works
-            }
-         }
-         return *this; //Added some fucking comment   asdasdasd
+         return cur.UnevaluatedBegin();
       }
 
-      bool operator==( const LazyLimit& other ) const
+      _Iter End() const
       {
-         return _begin == other._begin && 
-                _end == other._end &&
-                _cur == other._cur &&
-                _index == other._index &&
-                _limit == other._limit;
+         return cur.end();
       }
 
-      bool operator!=( const LazyLimit& other ) const
+      _Iter cur;
+   };
+
+   //! \brief State of an operation that all its iterators share, e.g. its function
+   //!
+   //! Iterators are copied all the time, so a reference count would be updated with every copy. States that
+   //! are trivially copyable and not larger than the reference, e.g. functions without captures or the
+   //! functions of a prepared pipeline, are copied along with the iterators instead
+   //! \tparam _State Type of the state
+   template<typename _State, typename = void>
+   class _Shared
+   {
+   public:
+      explicit _Shared( _State state ) :
+         _state( std::make_shared<const _State>( std::move( state ) ) )
       {
-         return !operator==( other );
       }
 
-      LazyLimit begin() const
+      const _State* operator->() const
       {
-         size_t startIdx = 0;
-         if ( _begin == _end ) startIdx = _limit; //To prevent a crash with empty ranges
-         return LazyLimit(_begin, _end, _begin, startIdx, _limit);
+         return _state.get();
       }
 
-      LazyLimit end() const
+      const _State& operator*() const
       {
-         //This is the end of the unlimited range, however once the limit is reached on a range, the _cur
-         //iterator is set to _end, thus making this work
-         return LazyLimit(_begin, _end, _end, _limit, _limit);
+         return *_state;
       }
    private:
-      _Iter _begin;
-      _Iter _end;
-      _Iter _cur;
-      size_t _index;
-      size_t _limit;
+      std::shared_ptr<const _State> _state;
    };
 
-#pragma endregion
-
-#pragma region LazyRanges
-
-   //! \brief Range for a common container
-   template<typename _Cont, typename _ValType = typename _Cont::value_type, typename _Iter = typename _Cont::const_iterator>
-   class ContainerRange : public std::iterator<std::forward_iterator_tag, _ValType>
+   template<typename _State>
+   class _Shared<_State, std::enable_if_t<std::is_trivially_copyable_v<_State> &&
+                                          sizeof( _State ) <= sizeof( std::shared_ptr<const _State> )>>
    {
    public:
-      using _IterType = _Iter;
-
-      ContainerRange( const _Cont& cont ) :
-         _begin( std::begin( cont ) ),
-         _end( std::end( cont ) ),
-         _cur( std::begin( cont ) )
+      explicit _Shared( _State state ) :
+         _state( state )
       {
       }
 
-      ContainerRange( const ContainerRange& other ) = default;
-      ContainerRange& operator=( const ContainerRange& other ) = default;
+      _Shared( const _Shared& ) = default;
 
-      ContainerRange& operator++( )
+      //! \brief Closures can't be assigned, but trivially copyable ones can be copied over
+      _Shared& operator=( const _Shared& other )
       {
-         if ( _cur != _end ) ++_cur;
+         std::destroy_at( &_state );
+         new ( &_state ) _State( other._state );
          return *this;
       }
 
-      const _ValType& operator*( ) const
+      const _State* operator->() const
       {
-         if ( _cur == _end ) throw std::exception( "Dereferencing end iterator!" );
-         return *_cur;
+         return &_state;
       }
 
-      bool operator==( const ContainerRange& other ) const
+      const _State& operator*() const
       {
-         return _begin == other._begin && _end == other._end && _cur == other._cur;
+         return _state;
       }
+   private:
+      _State _state;
+   };
 
-      bool operator!=( const ContainerRange& other ) const
+   //! \brief Execution policy for terminal operations that evaluates a range in blocks of elements
+   //!
+   //! Applies to ranges of arithmetic values over a contiguous source. Each map runs as a simple loop over a
+   //! block and each filter as a mask-and-compress step, which the compiler can turn into SIMD code. All other
+   //! ranges are evaluated element by element
+   struct Vectorized
+   {
+      enum : size_t
       {
-         return operator==( other );
-      }
+         //! Number of source elements per block
+         BlockSize = 256
+      };
+   };
 
-      _Iter begin() const
-      {
-         return _begin;
-      }
+   //! \brief Iterator category of a lazy operation that keeps the random access capability of the
+   //!        nested iterator. All other iterators are treated as forward iterators
+   template<typename _Iter>
+   using _StageCategory = typename std::conditional<std::is_base_of<std::random_access_iterator_tag,
+                                                                    typename std::iterator_traits<_Iter>::iterator_category>::value,
+                                                    std::random_access_iterator_tag,
+                                                    std::forward_iterator_tag>::type;
 
-      _Iter end() const
+   //! \brief Type that dereferencing an iterator of type _Iter returns. This is a reference for iterators of a
+   //!        container and a value for operations that create new elements, e.g. map
+   template<typename _Iter>
+   using _IterReference = decltype( *std::declval<const _Iter&>() );
+
+   //! \brief Reads a batch with NextBatch of the iterator, for lazy operations that implement it
+   template<typename _Iter, typename _Val>
+   auto _NextBatch( _Iter& cur, const _Iter&, _Val* out, size_t count, int ) -> decltype( cur.NextBatch( out, count ) )
+   {
+      return cur.NextBatch( out, count );
+   }
+
+   //! \brief All other iterators are read element by element
+   template<typename _Iter, typename _Val>
+   size_t _NextBatch( _Iter& cur, const _Iter& end, _Val* out, size_t count, long )
+   {
+      size_t read = 0;
+      for ( ; read < count && cur != end; ++cur ) out[read++] = *cur;
+      return read;
+   }
+
+   //! \brief Reads up to count elements of a range into a buffer and advances the iterator past them
+   //!
+   //! Filter, map and limit fill the whole batch in a single call. This saves the end checks of the iterator
+   //! interface for each element, and for arithmetic values the nested operations are evaluated on blocks of
+   //! elements. The iterators of all other operations and of containers are read element by element
+   //! \param cur Iterator at the first element to read, e.g. the begin of a lazy range
+   //! \param end End of the range
+   //! \param out Receives the elements, has to hold at least count elements
+   //! \param count Maximum number of elements to read
+   //! \returns Number of elements read, less than count only at the end of the range
+   template<typename _Iter, typename _Val>
+   size_t NextBatch( _Iter& cur, const _Iter& end, _Val* out, size_t count )
+   {
+      return _NextBatch( cur, end, out, count, 0 );
+   }
+
+#pragma endregion
+
+#pragma region Instrumentation
+
+   //Defining LAZY_INSTRUMENTATION makes filter, map and limit record how many elements they receive and pass
+   //on, and how much time is spent in their functions. LazyRange::Report returns these statistics for a
+   //whole chain. Without LAZY_INSTRUMENTATION, the operations store their functions as they are, so there is
+   //no overhead at all. The define has to be the same in all translation units of a program
+
+#ifdef LAZY_INSTRUMENTATION
+
+   //! \brief Statistics of a single lazy operation
+   struct StageReport
+   {
+      //! \brief Fraction of the received elements that were passed on
+      double Selectivity() const
       {
-         return _end;
+         return elementsIn ? static_cast<double>( elementsOut ) / elementsIn : 1.0;
       }
 
-      bool IsAtEnd() const
+      //! Name of the operation, e.g. Filter
+      const char* name;
+      //! Number of elements that the operation received
+      uint64_t elementsIn;
+      //! Number of elements that the operation passed on
+      uint64_t elementsOut;
+      //! Time spent in the function of the operation, summed over all threads
+      std::chrono::nanoseconds time;
+   };
+
+   //! \brief Statistics of the instrumented operations of a chain
+   struct PipelineReport
+   {
+      //! \brief One line per operation, in the order of the chain
+      std::string ToString() const
       {
-         return _cur == _end;
+         std::ostringstream str;
+         for ( auto& stage : stages )
+         {
+            str << stage.name << ": " << stage.elementsIn << " in, " << stage.elementsOut << " out, selectivity "
+                << stage.Selectivity() << ", " << stage.time.count() / 1e6 << " ms\n";
+         }
+         return str.str();
       }
-   private:
-      _Iter _begin;
-      _Iter _end;
-      _Iter _cur;
+
+      //! The operations from the source to the end of the chain
+      std::vector<StageReport> stages;
    };
 
-   template<typename _ValType,
-            typename _Range,
-            typename _Iter = typename _Range::_IterType>
-   class LazyRange : public std::iterator<std::forward_iterator_tag, _ValType>
+   //! \brief Counters of an instrumented operation, shared by all copies of the operation
+   class _StageStats
    {
    public:
-      using _ThisType = LazyRange;
-
-      LazyRange( _Range range ) :
-         _range( range )
+      explicit _StageStats( const char* name ) :
+         _name( name ),
+         _in( 0 ),
+         _out( 0 ),
+         _nanoseconds( 0 )
       {
       }
 
-      LazyRange( const _ThisType& other ) :
-         _range( other._range )
+      void Record( bool passed )
       {
+         _in.fetch_add( 1, std::memory_order_relaxed );
+         if ( passed ) _out.fetch_add( 1, std::memory_order_relaxed );
       }
 
-      _ThisType& operator=( const _ThisType& other )
+      void Record( bool passed, std::chrono::steady_clock::duration time )
       {
-         _range = other._range;
+         Record( passed );
+         auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>( time ).count();
+         _nanoseconds.fetch_add( static_cast<uint64_t>( nanoseconds ), std::memory_order_relaxed );
       }
 
-      _ThisType& operator++( )
+      StageReport Report() const
       {
-         ++_range;
-         return *this;
+         return StageReport{ _name, _in.load(), _out.load(), std::chrono::nanoseconds( _nanoseconds.load() ) };
       }
+   private:
+      const char* _name;
+      std::atomic<uint64_t> _in;
+      std::atomic<uint64_t> _out;
+      std::atomic<uint64_t> _nanoseconds;
+   };
 
-      _ValType operator*( ) const
+   //! \brief Function of a filter or map operation that records each call
+   //!
+   //! Copies share their counters, so the copies of an operation that are made during iteration, or for
+   //! the chunks of a parallel evaluation, all count towards the same statistics
+   //! \tparam _Fn Type of the wrapped function
+   //! \tparam _IsFilter Whether the function is a predicate, whose result decides if an element is passed on
+   template<typename _Fn, bool _IsFilter>
+   class _InstrumentedFn
+   {
+   public:
+      _InstrumentedFn( const _Fn& fn ) :
+         _fn( fn ),
+         _stats( std::make_shared<_StageStats>( _IsFilter ? "Filter" : "Map" ) )
       {
-         return *_range;
       }
 
-      bool operator==( const _ThisType& other ) const
+      template<typename... _Args>
+      auto operator()( _Args&&... args ) const -> decltype( std::declval<const _Fn&>()( std::forward<_Args>( args )... ) )
       {
-         return _range == other._range;
+         auto start = std::chrono::steady_clock::now();
+         decltype( auto ) result = _fn( std::forward<_Args>( args )... );
+         _stats->Record( Passed( result, std::integral_constant<bool, _IsFilter>() ), std::chrono::steady_clock::now() - start );
+         return static_cast<decltype( result )&&>( result );
       }
 
-      bool operator!=( const _ThisType& other ) const
+      StageReport Report() const
       {
-         return !operator==( other );
+         return _stats->Report();
       }
-
-      _Iter begin( ) const
+   private:
+      template<typename _Result>
+      static bool Passed( const _Result& result, std::true_type )
       {
-         return std::begin( _range ); 
+         return static_cast<bool>( result );
       }
-      
-      _Iter end( ) const
+
+      //! \brief A map passes on every element
+      template<typename _Result>
+      static bool Passed( const _Result&, std::false_type )
       {
-         return std::end( _range );
+         return true;
       }
 
-      //The transformation methods
+      _Fn _fn;
+      std::shared_ptr<_StageStats> _stats;
+   };
 
-      //! \brief Apply a map operation to this range
-      //! \param map The map function
-      //! \returns A LazyRange with the mapping operation applied
-      //! \tparam _Dst The destination type of the map operation
-      template<typename _Dst>
-      LazyRange<_Dst, LazyMap<_ValType, _Dst, _Iter>> Map( const _Map<_ValType, _Dst>& map ) const
-      {
-         using _MapType = LazyMap<_ValType, _Dst, _Iter>;
-         using _Ret = LazyRange<_Dst, _MapType>;
+   template<typename _Fn> using _FilterFn = _InstrumentedFn<_Fn, true>;
+   template<typename _Fn> using _MapFn = _InstrumentedFn<_Fn, false>;
 
-         auto iter = _MapType( std::begin( _range ), std::end( _range ), std::begin( _range ), map );
-         return _Ret( iter );
-      }
+   //! \brief Appends the reports of an instrumented operation and the operations nested in it
+   template<typename _Iter>
+   auto _CollectReports( const _Iter& iter, std::vector<StageReport>& reports, int ) -> decltype( iter.CollectReports( reports ) )
+   {
+      iter.CollectReports( reports );
+   }
 
-      //! \brief Apply a map operation to this range
-      //! \param map The map function
-      //! \returns A LazyRange with the mapping operation applied
-      LazyRange<_ValType, LazyMap<_ValType, _ValType, _Iter>> Map( const _Map<_ValType, _ValType>& map ) const
-      {
-         using _MapType = LazyMap<_ValType, _ValType, _Iter>;
-         using _Ret = LazyRange<_ValType, _MapType>;
+   //! \brief Source iterators and operations without instrumentation end the chain of reports
+   template<typename _Iter>
+   void _CollectReports( const _Iter&, std::vector<StageReport>&, long )
+   {
+   }
 
-         auto iter = _MapType( std::begin( _range ), std::end( _range ), std::begin( _range ), map );
-         return _Ret( iter );
-      }
+#else
 
-      //! \brief Apply a filter operation to this range
+   template<typename _Fn> using _FilterFn = _Fn;
+   template<typename _Fn> using _MapFn = _Fn;
+
+#endif
+
+#pragma endregion
+
+#pragma region LazyOperations
+
+   //Each lazy operation can be evaluated in two ways. As an iterator, elements are pulled through the chain
+   //one at a time, with every operation checking for the end of its nested iterator. With Push, the loop over
+   //the source drives the evaluation and pushes each element through the operations into a sink. The sink
+   //returns false once it does not accept more elements, which stops the loop over the source. Terminal
+   //operations of LazyRange use Push. Operations that don't change the elements, e.g. filter and limit,
+   //pass them on as they get them, so elements of the source stay references and temporaries, e.g. the
+   //results of a map, stay rvalues that terminal operations can move
+
+   template<typename _ValType, typename _Iter> struct _LimitStage;
+
+   //! \brief Predicate of two adjacent filters that were merged into one
+   //! \tparam _ValType Value type of the filtered range
+   //! \tparam _First Type of the predicate of the first filter, which is evaluated first
+   //! \tparam _Second Type of the predicate of the second filter
+   template<typename _ValType, typename _First, typename _Second>
+   class _ConjoinedPred
+   {
+   public:
+      _ConjoinedPred( const _First& first, const _Second& second ) :
+         _first( first ),
+         _second( second )
+      {
+      }
+
+      bool operator()( const _ValType& val ) const
+      {
+         return _first( val ) && _second( val );
+      }
+   private:
+      _First _first;
+      _Second _second;
+   };
+
+   //! \brief Function of two adjacent maps that were fused into one
+   //! \tparam _SrcType Source type of the first map
+   //! \tparam _MidType Destination type of the first map, which is the source type of the second map
+   //! \tparam _First Type of the function of the first map
+   //! \tparam _Second Type of the function of the second map
+   template<typename _SrcType, typename _MidType, typename _First, typename _Second>
+   class _ComposedMap
+   {
+   public:
+      _ComposedMap( const _First& first, const _Second& second ) :
+         _first( first ),
+         _second( second )
+      {
+      }
+
+      _MapResult<_Second, _MidType> operator()( const _SrcType& val ) const
+      {
+         //The intermediate value is converted to the destination type of the first map, as it was before fusing
+         const _MidType& mid = _first( val );
+         return _second( mid );
+      }
+   private:
+      _First _first;
+      _Second _second;
+   };
+
+   //! \brief Function of an operation of a Pipeline, which refers to the function stored in the pipeline
+   //!
+   //! Copying an operation only copies the pointer, so binding a pipeline to a new source does not copy or
+   //! allocate any function, no matter how often the operations are copied
+   //! \tparam _Fn Type of the referenced function
+   template<typename _Fn>
+   class _FnRef
+   {
+   public:
+      explicit _FnRef( const _Fn* fn ) :
+         _fn( fn )
+      {
+      }
+
+      template<typename... _Args>
+      auto operator()( _Args&&... args ) const -> decltype( std::declval<const _Fn&>()( std::forward<_Args>( args )... ) )
+      {
+         return ( *_fn )( std::forward<_Args>( args )... );
+      }
+   private:
+      const _Fn* _fn;
+   };
+
+   //! \brief Lazy iterator that implements a filter operation
+   //! \tparam _ValType Value type of the iterator
+   //! \tparam _Iter Type of the nested iterator
+   //! \tparam _Fn Type of the predicate. Any callable other than the default std::function is stored with its
+   //!             concrete type, so calls to it can be inlined
+   template<typename _ValType,
+            typename _Iter,
+            typename _Fn = _Pred<_ValType>>
+   class LazyFilter : public std::iterator<std::forward_iterator_tag, _ValType, ptrdiff_t, const _ValType*, _IterReference<_Iter>>
+   {
+   public:
+      using _IterType = LazyFilter;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      using _Splittable = typename _SourceAccess<_Iter>::_Splittable;
+      //! The number of elements that pass the filter is only known after evaluating it
+      using _SizeKnown = std::false_type;
+      using _Vectorizable = typename _SourceAccess<_Iter>::_Vectorizable;
+
+      LazyFilter( _Iter start,
+                  _Iter end, 
+                  _Iter cur,
+                  const _FilterFn<_Fn>& pred ) :
+         _nested( start, end, cur ),
+         _state( _State{ pred } )
+      {
+      }
+
+      LazyFilter& operator++(  )
+      {
+         //Filter skips elements, so we always increment to the next element that matches the predicate
+         //or to the end
+         if ( IsAtEnd() ) return *this;
+         //Skip all elements that don't match the predicate
+         do
+         {
+            ++_nested.cur;
+         }
+         while ( !IsAtEnd() && 
+                  !_state->pred( *_nested.cur ) );
+         return *this;
+      }
+
+      //! \brief Returns the current element of the nested iterator as it is, i.e. without copying it if the
+      //!        nested iterator returns a reference
+      _IterReference<_Iter> operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return *_nested.cur;
+      }
+
+      //! \brief Iterators of the same range only differ in their position
+      bool operator==( const LazyFilter& other ) const
+      {
+         return _nested.cur == other._nested.cur;
+      }
+      
+      bool operator!=( const LazyFilter& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _nested.AtEnd();
+      }
+
+      LazyFilter begin( ) const
+      {
+         //Move to the first valid element
+         auto begin = _nested.At( _SourceAccess<_Iter>::First( _nested.Begin() ) );
+         while ( !begin.AtEnd() &&
+                  !_state->pred( *begin.cur ) )
+         {
+            ++begin.cur;
+         }
+         return LazyFilter( begin, _state );
+      }
+
+      LazyFilter end( ) const
+      {
+         return LazyFilter( _nested.At( _nested.End() ), _state );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyFilter UnevaluatedBegin() const
+      {
+         return LazyFilter( _nested.At( _nested.Begin() ), _state );
+      }
+
+      _SourceIterType SourceBegin() const
+      {
+         return _SourceAccess<_Iter>::Begin( _nested.Begin(), _nested.End() );
+      }
+
+      _SourceIterType SourceEnd() const
+      {
+         return _SourceAccess<_Iter>::End( _nested.Begin(), _nested.End() );
+      }
+
+      //! \brief Returns this operation applied to the given subrange of the source container
+      //! \param first Begin of the subrange
+      //! \param last End of the subrange
+      LazyFilter Rebase( _SourceIterType first, _SourceIterType last ) const
+      {
+         auto nested = _SourceAccess<_Iter>::Rebase( _nested.Begin(), first, last );
+         return LazyFilter( _Nested<_Iter>( nested.first, nested.second, nested.first ), _state );
+      }
+
+      //! \brief Upper bound on the number of elements in this range
+      size_t SizeHint() const
+      {
+         return _SourceAccess<_Iter>::SizeHint( _nested.Begin(), _nested.End() );
+      }
+
+      //! \brief Evaluates this operation on a block of source elements
+      //! \param src The source elements
+      //! \param count Number of source elements, at most Vectorized::BlockSize
+      //! \param out Receives the elements that pass the filter
+      //! \returns Number of elements that passed the filter
+      template<typename _SrcVal>
+      size_t EvalBlock( const _SrcVal* src, size_t count, _ValType* out ) const
+      {
+         size_t nestedCount;
+         const _ValType* in = _SourceAccess<_Iter>::EvalBlock( _nested.Begin(), src, count, out, nestedCount );
+
+         //Evaluate the predicate for the whole block first, then compress without branches
+         const auto& pred = _state->pred;
+         bool mask[Vectorized::BlockSize];
+         for ( size_t i = 0; i < nestedCount; i++ ) mask[i] = pred( in[i] );
+
+         size_t passed = 0;
+         for ( size_t i = 0; i < nestedCount; i++ )
+         {
+            out[passed] = in[i];
+            passed += mask[i] ? 1 : 0;
+         }
+         return passed;
+      }
+
+      //! \brief Whether an element of the nested range passes the filter
+      bool Selects( const _ValType& val ) const
+      {
+         return _state->pred( val );
+      }
+
+      //! \brief Pushes all elements of this range into the sink
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         const auto& pred = _state->pred;
+         auto filter = [&pred, &sink] ( auto&& val )
+         {
+            return !pred( val ) || sink( std::forward<decltype( val )>( val ) );
+         };
+         return _SourceAccess<_Iter>::Push( _nested.Begin(), _nested.End(), filter );
+      }
+
+      //! \brief Reads up to count elements, starting at the current one, and advances this iterator past them
+      //! \param out Receives the elements, has to hold at least count elements
+      //! \param count Maximum number of elements to read
+      //! \returns Number of elements read, less than count only at the end of the range
+      size_t NextBatch( _ValType* out, size_t count )
+      {
+         return NextBatch( out, count, std::is_arithmetic<_ValType>() );
+      }
+
+      //! \brief Returns a single filter that evaluates the predicate of this filter and then the given one
+      //! \param next Predicate of a filter that follows this filter
+      template<typename _NextFn>
+      LazyFilter<_ValType, _Iter, _ConjoinedPred<_ValType, _Fn, _NextFn>> Merged( const _NextFn& next ) const
+      {
+         using _MergedType = LazyFilter<_ValType, _Iter, _ConjoinedPred<_ValType, _Fn, _NextFn>>;
+         return _MergedType( _nested.Begin(), _nested.End(), _nested.Begin(), _ConjoinedPred<_ValType, _Fn, _NextFn>( _state->pred, next ) );
+      }
+
+#ifdef LAZY_INSTRUMENTATION
+      //! \brief Appends the reports of the nested operations and of this operation
+      void CollectReports( std::vector<StageReport>& reports ) const
+      {
+         _CollectReports( _nested.Begin(), reports, 0 );
+         reports.push_back( _state->pred.Report() );
+      }
+#endif
+   private:
+      //! \brief Predicate, which all iterators of the range and its rebased copies share instead of copying it
+      struct _State
+      {
+         _FilterFn<_Fn> pred;
+      };
+
+      LazyFilter( const _Nested<_Iter>& nested, const _Shared<_State>& state ) :
+         _nested( nested ),
+         _state( state )
+      {
+      }
+
+      //! \brief Arithmetic values are written to the batch before the predicate is evaluated, so that the
+      //!        loop has no branch that depends on the predicate
+      size_t NextBatch( _ValType* out, size_t count, std::true_type )
+      {
+         if ( count == 0 || IsAtEnd() ) return 0;
+
+         //_nested.cur is always at an element that passed the filter
+         const auto& pred = _state->pred;
+         size_t read = 0;
+         out[read++] = *_nested.cur;
+         for ( ++_nested.cur; read < count && !IsAtEnd(); ++_nested.cur )
+         {
+            out[read] = *_nested.cur;
+            read += pred( out[read] ) ? 1 : 0;
+         }
+         //Move to the next element that matches the predicate, like the increment operator
+         while ( !IsAtEnd() &&
+                  !pred( *_nested.cur ) )
+         {
+            ++_nested.cur;
+         }
+         return read;
+      }
+
+      size_t NextBatch( _ValType* out, size_t count, std::false_type )
+      {
+         size_t read = 0;
+         for ( ; read < count && !IsAtEnd(); operator++() ) out[read++] = *_nested.cur;
+         return read;
+      }
+
+      _Nested<_Iter> _nested;
+      _Shared<_State> _state;
+   };
+
+   //! \brief Lazy iterator that implements a map operation
+   //! \tparam _SrcType Source type of the map operation
+   //! \tparam _DstType Destination type of the map operation
+   //! \tparam _Iter Type of the nested iterator
+   //! \tparam _Fn Type of the map function. Any callable other than the default std::function is stored with its
+   //!             concrete type, so calls to it can be inlined
+   template<typename _SrcType,
+            typename _DstType,
+            typename _Iter,
+            typename _Fn = _Map<_SrcType, _DstType>>
+   class LazyMap : public std::iterator<_StageCategory<_Iter>, _DstType>
+   {
+   public:
+      //! \brief Mapped elements are returned by value. Declared here rather than as an argument of the base, which
+      //!        would then be the same as that of a nested filter, and no longer take up zero bytes
+      using reference = _DstType;
+      using _IterType = LazyMap;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      using _Splittable = typename _SourceAccess<_Iter>::_Splittable;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::integral_constant<bool, _SourceAccess<_Iter>::_Vectorizable::value &&
+                                                        std::is_arithmetic<_DstType>::value>;
+
+      LazyMap( _Iter begin, 
+               _Iter end, 
+               _Iter cur, 
+               const _MapFn<_Fn>& map ) :
+         _nested( begin, end, cur ),
+         _state( _State{ map } )
+      {
+      }
+
+      LazyMap& operator++( )
+      {
+         //Map does not skip elements, so the increment operator is simple
+         if ( !IsAtEnd() ) ++_nested.cur;
+         return *this;
+      }
+
+      LazyMap operator++( int )
+      {
+         auto ret = *this;
+         ++*this;
+         return ret;
+      }
+
+      _DstType operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return _state->map( *_nested.cur );
+      }
+
+      //! \brief Iterators of the same range only differ in their position
+      bool operator==( const LazyMap& other ) const
+      {
+         return _nested.cur == other._nested.cur;
+      }
+
+      bool operator!=( const LazyMap& other ) const
+      {
+         return !operator==( other );
+      }
+
+      //Random access operations, these are only available if the nested iterator is random access
+
+      LazyMap& operator--( )
+      {
+         --_nested.cur;
+         return *this;
+      }
+
+      LazyMap operator--( int )
+      {
+         auto ret = *this;
+         --*this;
+         return ret;
+      }
+
+      LazyMap& operator+=( ptrdiff_t offset )
+      {
+         _nested.cur += offset;
+         return *this;
+      }
+
+      LazyMap& operator-=( ptrdiff_t offset )
+      {
+         _nested.cur -= offset;
+         return *this;
+      }
+
+      LazyMap operator+( ptrdiff_t offset ) const
+      {
+         return LazyMap( _nested.At( _nested.cur + offset ), _state );
+      }
+
+      friend LazyMap operator+( ptrdiff_t offset, const LazyMap& iter )
+      {
+         return iter + offset;
+      }
+
+      LazyMap operator-( ptrdiff_t offset ) const
+      {
+         return LazyMap( _nested.At( _nested.cur - offset ), _state );
+      }
+
+      ptrdiff_t operator-( const LazyMap& other ) const
+      {
+         return _nested.cur - other._nested.cur;
+      }
+
+      _DstType operator[]( ptrdiff_t offset ) const
+      {
+         return *( *this + offset );
+      }
+
+      bool operator<( const LazyMap& other ) const
+      {
+         return _nested.cur < other._nested.cur;
+      }
+
+      bool operator>( const LazyMap& other ) const
+      {
+         return other < *this;
+      }
+
+      bool operator<=( const LazyMap& other ) const
+      {
+         return !( other < *this );
+      }
+
+      bool operator>=( const LazyMap& other ) const
+      {
+         return !( *this < other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _nested.AtEnd();
+      }
+
+      LazyMap begin() const
+      {
+         return LazyMap( _nested.At( _SourceAccess<_Iter>::First( _nested.Begin() ) ), _state );
+      }
+
+      LazyMap end() const
+      {
+         return LazyMap( _nested.At( _nested.End() ), _state );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyMap UnevaluatedBegin() const
+      {
+         return LazyMap( _nested.At( _nested.Begin() ), _state );
+      }
+
+      _SourceIterType SourceBegin() const
+      {
+         return _SourceAccess<_Iter>::Begin( _nested.Begin(), _nested.End() );
+      }
+
+      _SourceIterType SourceEnd() const
+      {
+         return _SourceAccess<_Iter>::End( _nested.Begin(), _nested.End() );
+      }
+
+      //! \brief Returns this operation applied to the given subrange of the source container
+      //! \param first Begin of the subrange
+      //! \param last End of the subrange
+      LazyMap Rebase( _SourceIterType first, _SourceIterType last ) const
+      {
+         auto nested = _SourceAccess<_Iter>::Rebase( _nested.Begin(), first, last );
+         return LazyMap( _Nested<_Iter>( nested.first, nested.second, nested.first ), _state );
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         return _SourceAccess<_Iter>::SizeHint( _nested.Begin(), _nested.End() );
+      }
+
+      //! \brief Evaluates this operation on a block of source elements
+      //! \param src The source elements
+      //! \param count Number of source elements, at most Vectorized::BlockSize
+      //! \param out Receives the mapped elements
+      //! \returns Number of mapped elements
+      template<typename _SrcVal>
+      size_t EvalBlock( const _SrcVal* src, size_t count, _DstType* out ) const
+      {
+         _SrcType buffer[Vectorized::BlockSize];
+         size_t nestedCount;
+         const _SrcType* in = _SourceAccess<_Iter>::EvalBlock( _nested.Begin(), src, count, buffer, nestedCount );
+
+         const auto& map = _state->map;
+         for ( size_t i = 0; i < nestedCount; i++ ) out[i] = map( in[i] );
+         return nestedCount;
+      }
+
+      //! \brief Pushes all elements of this range into the sink
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         const auto& fn = _state->map;
+         auto map = [&fn, &sink] ( const _SrcType& val )
+         {
+            return sink( fn( val ) );
+         };
+         return _SourceAccess<_Iter>::Push( _nested.Begin(), _nested.End(), map );
+      }
+
+      //! \brief Reads up to count elements, starting at the current one, and advances this iterator past them
+      //! \param out Receives the mapped elements, has to hold at least count elements
+      //! \param count Maximum number of elements to read
+      //! \returns Number of elements read, less than count only at the end of the range
+      size_t NextBatch( _DstType* out, size_t count )
+      {
+         return NextBatch( out, count, std::is_arithmetic<_SrcType>() );
+      }
+
+      //! \brief Returns a single map that applies the function of this map and then the given one
+      //! \param next Function of a map that follows this map
+      //! \tparam _NextDst Destination type of the following map
+      template<typename _NextDst, typename _NextFn>
+      LazyMap<_SrcType, _NextDst, _Iter, _ComposedMap<_SrcType, _DstType, _Fn, _NextFn>> Fused( const _NextFn& next ) const
+      {
+         using _FusedType = LazyMap<_SrcType, _NextDst, _Iter, _ComposedMap<_SrcType, _DstType, _Fn, _NextFn>>;
+         return _FusedType( _nested.Begin(), _nested.End(), _nested.Begin(), _ComposedMap<_SrcType, _DstType, _Fn, _NextFn>( _state->map, next ) );
+      }
+
+      //! \brief Returns this map applied to the nested range limited to the given number of elements
+      //!
+      //! A map neither drops nor adds elements, so this has the same elements as a limit after this map. Below
+      //! the map, the limit can be absorbed by the nested operation, e.g. the bounded heap of OrderBy, and a map
+      //! that follows can still be fused with this one
+      template<typename _Limited = typename _LimitStage<_SrcType, _Iter>::_Type>
+      LazyMap<_SrcType, _DstType, _Limited, _Fn> Limited( size_t limit ) const
+      {
+         auto limited = _LimitStage<_SrcType, _Iter>::Make( _nested.Begin(), _nested.End(), limit );
+         return LazyMap<_SrcType, _DstType, _Limited, _Fn>( limited.UnevaluatedBegin(), limited.end(), limited.UnevaluatedBegin(), _state->map );
+      }
+
+#ifdef LAZY_INSTRUMENTATION
+      //! \brief Appends the reports of the nested operations and of this operation
+      void CollectReports( std::vector<StageReport>& reports ) const
+      {
+         _CollectReports( _nested.Begin(), reports, 0 );
+         reports.push_back( _state->map.Report() );
+      }
+#endif
+   private:
+      //! \brief Map function, which all iterators of the range and its rebased copies share instead of copying it
+      struct _State
+      {
+         _MapFn<_Fn> map;
+      };
+
+      LazyMap( const _Nested<_Iter>& nested, const _Shared<_State>& state ) :
+         _nested( nested ),
+         _state( state )
+      {
+      }
+
+      //! \brief Arithmetic values are read from the nested range in blocks, which are mapped in a simple loop
+      size_t NextBatch( _DstType* out, size_t count, std::true_type )
+      {
+         return NextBatchBuffered( out, count, std::is_same<_SrcType, _DstType>() );
+      }
+
+      //! \brief A map to the same type maps the elements of the nested batch in place
+      size_t NextBatchBuffered( _DstType* out, size_t count, std::true_type )
+      {
+         size_t read = _NextBatch( _nested.cur, _nested.End(), out, count, 0 );
+         const auto& map = _state->map;
+         for ( size_t i = 0; i < read; i++ ) out[i] = map( out[i] );
+         return read;
+      }
+
+      size_t NextBatchBuffered( _DstType* out, size_t count, std::false_type )
+      {
+         _SrcType buffer[Vectorized::BlockSize];
+         const auto& map = _state->map;
+         size_t read = 0;
+         while ( read < count )
+         {
+            size_t block = std::min( count - read, size_t( Vectorized::BlockSize ) );
+            size_t nested = _NextBatch( _nested.cur, _nested.End(), buffer, block, 0 );
+            for ( size_t i = 0; i < nested; i++ ) out[read + i] = map( buffer[i] );
+            read += nested;
+            if ( nested < block ) break;
+         }
+         return read;
+      }
+
+      size_t NextBatch( _DstType* out, size_t count, std::false_type )
+      {
+         size_t read = 0;
+         const auto& map = _state->map;
+         for ( ; read < count && !IsAtEnd(); ++_nested.cur ) out[read++] = map( *_nested.cur );
+         return read;
+      }
+
+      _Nested<_Iter> _nested;
+      _Shared<_State> _state;
+   };
+
+   //! \brief Lazy iterator that is limited to a specific number of elements
+   //! \tparam _ValType Value type of the iterator
+   //! \tparam _Iter Type of the nested iterator
+   template<typename _ValType,
+            typename _Iter>
+   class LazyLimit : public std::iterator<std::forward_iterator_tag, _ValType, ptrdiff_t, const _ValType*, _IterReference<_Iter>>
+   {
+   public:
+      using _IterType = LazyLimit;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! The limit applies to the whole range, so a limited range can't be split into chunks
+      using _Splittable = std::false_type;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::false_type;
+
+      LazyLimit( _Iter begin, _Iter end, _Iter cur, size_t idx, size_t limit ) :
+         _nested( begin, end, cur ),
+         _index( idx ),
+         _state( _State{ limit } )
+      {
+      }
+
+      LazyLimit(const LazyLimit& other) = default;
+      LazyLimit& operator=( const LazyLimit& ) = default;
+
+      //! \brief Returns the current element of the nested iterator as it is
+      _IterReference<_Iter> operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return *_nested.cur;
+      }
+
+      LazyLimit& operator++( )
+      {
+         if ( !IsAtEnd() )
+         {
+#ifdef LAZY_INSTRUMENTATION
+            _state->stats->Record( true );
+#endif
+            ++_index;
+            //The nested iterator is only advanced if there are elements left, otherwise a nested filter
+            //would evaluate elements that are not part of this range anymore
+            if ( _index != _state->limit ) ++_nested.cur;
+         }
+         return *this;
+      }
+
+      bool operator==( const LazyLimit& other ) const
+      {
+         //All iterators that reached the limit or the end of the nested range compare equal, this way
+         //reaching the limit does not require walking the nested iterator to its end
+         bool atEnd = IsAtEnd();
+         if ( atEnd || other.IsAtEnd() ) return atEnd == other.IsAtEnd();
+         return _nested.cur == other._nested.cur &&
+                _index == other._index;
+      }
+
+      bool operator!=( const LazyLimit& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _index == _state->limit ||
+                _nested.AtEnd();
+      }
+
+      LazyLimit begin() const
+      {
+         return LazyLimit( _nested.At( _SourceAccess<_Iter>::First( _nested.Begin() ) ), 0, _state );
+      }
+
+      LazyLimit end() const
+      {
+         return LazyLimit( _nested.At( _nested.End() ), _state->limit, _state );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyLimit UnevaluatedBegin() const
+      {
+         return LazyLimit( _nested.At( _nested.Begin() ), 0, _state );
+      }
+
+      _SourceIterType SourceBegin() const
+      {
+         return _SourceAccess<_Iter>::Begin( _nested.Begin(), _nested.End() );
+      }
+
+      _SourceIterType SourceEnd() const
+      {
+         return _SourceAccess<_Iter>::End( _nested.Begin(), _nested.End() );
+      }
+
+      //! \brief Returns this operation applied to another source. The limit applies to the whole range, so
+      //!        this is not used to split a range into chunks, but to bind a Pipeline to a new source
+      //! \param first Begin of the source
+      //! \param last End of the source
+      LazyLimit Rebase( _SourceIterType first, _SourceIterType last ) const
+      {
+         auto nested = _SourceAccess<_Iter>::Rebase( _nested.Begin(), first, last );
+         return LazyLimit( _Nested<_Iter>( nested.first, nested.second, nested.first ), 0, _state );
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         return std::min( _state->limit, _SourceAccess<_Iter>::SizeHint( _nested.Begin(), _nested.End() ) );
+      }
+
+      //! \brief Pushes all elements of this range into the sink
+      //!
+      //! Once the limit is reached, the loop over the source is stopped. This is not reported as the sink
+      //! stopping the evaluation
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         const _State& state = *_state;
+         if ( state.limit == 0 ) return true;
+
+         size_t count = 0;
+         bool accepting = true;
+         auto limit = [&state, &sink, &count, &accepting] ( auto&& val )
+         {
+#ifdef LAZY_INSTRUMENTATION
+            state.stats->Record( true );
+#endif
+            accepting = sink( std::forward<decltype( val )>( val ) );
+            return accepting && ++count < state.limit;
+         };
+         _SourceAccess<_Iter>::Push( _nested.Begin(), _nested.End(), limit );
+         return accepting;
+      }
+
+      //! \brief Reads up to count elements, starting at the current one, and advances this iterator past them
+      //!
+      //! Like the increment operator, this does not advance the nested iterator past the last element within
+      //! the limit
+      //! \param out Receives the elements, has to hold at least count elements
+      //! \param count Maximum number of elements to read
+      //! \returns Number of elements read, less than count only at the end of the range
+      size_t NextBatch( _ValType* out, size_t count )
+      {
+         if ( count == 0 || IsAtEnd() ) return 0;
+
+         size_t batch = std::min( count, _state->limit - _index - 1 );
+         size_t read = _NextBatch( _nested.cur, _nested.End(), out, batch, 0 );
+         _index += read;
+         if ( read == batch && read < count && !_nested.AtEnd() )
+         {
+            out[read++] = *_nested.cur;
+            ++_index;
+         }
+#ifdef LAZY_INSTRUMENTATION
+         for ( size_t i = 0; i < read; i++ ) _state->stats->Record( true );
+#endif
+         return read;
+      }
+
+#ifdef LAZY_INSTRUMENTATION
+      //! \brief Appends the reports of the nested operations and of this operation. A limit stops the
+      //!        evaluation instead of dropping elements, so it passes on every element it receives
+      void CollectReports( std::vector<StageReport>& reports ) const
+      {
+         _CollectReports( _nested.Begin(), reports, 0 );
+         reports.push_back( _state->stats->Report() );
+      }
+#endif
+   private:
+      //! \brief Limit, which all iterators of the range and its rebased copies share
+      struct _State
+      {
+         size_t limit;
+#ifdef LAZY_INSTRUMENTATION
+         std::shared_ptr<_StageStats> stats = std::make_shared<_StageStats>( "Limit" );
+#endif
+      };
+
+      LazyLimit( const _Nested<_Iter>& nested, size_t idx, const _Shared<_State>& state ) :
+         _nested( nested ),
+         _index( idx ),
+         _state( state )
+      {
+      }
+
+      _Nested<_Iter> _nested;
+      size_t _index;
+      _Shared<_State> _state;
+   };
+
+   //! \brief Lazy iterator that memoizes the elements of the nested range
+   //!
+   //! Elements are evaluated the first time they are requested and stored in a chunked buffer, which is
+   //! shared by all copies of this iterator. Iterating the range again or dereferencing an element twice
+   //! reads from the buffer instead of evaluating the nested range again. The buffer is not synchronized,
+   //! so a cached range must not be iterated from multiple threads at the same time
+   //! \tparam _ValType Value type of the iterator
+   //! \tparam _Iter Type of the nested iterator
+   template<typename _ValType,
+            typename _Iter>
+   class LazyCache : public std::iterator<std::forward_iterator_tag, _ValType>
+   {
+      struct _State
+      {
+         _State( _Iter begin, _Iter end ) :
+            begin( begin ),
+            end( end ),
+            advance( false )
+         {
+         }
+
+         //! \brief Evaluates the nested range up to the given index
+         //! \returns True if the element at the given index exists
+         bool Fetch( size_t index )
+         {
+            while ( values.size() <= index )
+            {
+               //Lazy operations are not assignable, so the cursor is created once the first element is requested
+               if ( !cur )
+               {
+                  cur.reset( new _Iter( _SourceAccess<_Iter>::First( begin ) ) );
+               }
+               //The nested iterator is advanced only when the next element is requested, so that nothing
+               //is evaluated ahead of time
+               else if ( advance )
+               {
+                  ++*cur;
+               }
+               advance = false;
+
+               if ( *cur == end ) return false;
+               values.push_back( **cur );
+               advance = true;
+            }
+            return true;
+         }
+
+         bool IsExhausted() const
+         {
+            return cur && !advance && *cur == end;
+         }
+
+         const _Iter begin;
+         const _Iter end;
+         std::unique_ptr<_Iter> cur;
+         bool advance;
+         std::deque<_ValType> values;
+      };
+   public:
+      using _IterType = LazyCache;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! The buffer is filled in order, so a cached range can't be split into chunks
+      using _Splittable = std::false_type;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::false_type;
+
+      LazyCache( _Iter begin, _Iter end ) :
+         _state( std::make_shared<_State>( begin, end ) ),
+         _index( 0 )
+      {
+      }
+
+      LazyCache( const LazyCache& other ) = default;
+      LazyCache& operator=( const LazyCache& ) = default;
+
+      const _ValType& operator*( ) const
+      {
+         if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         return _state->values[_index];
+      }
+
+      LazyCache& operator++( )
+      {
+         if ( !IsAtEnd() ) ++_index;
+         return *this;
+      }
+
+      bool operator==( const LazyCache& other ) const
+      {
+         bool atEnd = IsAtEnd();
+         if ( atEnd || other.IsAtEnd() ) return atEnd == other.IsAtEnd();
+         return _state == other._state &&
+                _index == other._index;
+      }
+
+      bool operator!=( const LazyCache& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _index == EndIndex || !_state->Fetch( _index );
+      }
+
+      LazyCache begin() const
+      {
+         return LazyCache( _state, 0 );
+      }
+
+      LazyCache end() const
+      {
+         return LazyCache( _state, EndIndex );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyCache UnevaluatedBegin() const
+      {
+         return begin();
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         if ( _state->IsExhausted() ) return _state->values.size();
+         return _SourceAccess<_Iter>::SizeHint( _state->begin, _state->end );
+      }
+
+      //! \brief Pushes all elements of this range into the sink, evaluating only elements that are not cached yet
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         for ( size_t index = 0; _state->Fetch( index ); index++ )
+         {
+            if ( !sink( _state->values[index] ) ) return false;
+         }
+         return true;
+      }
+   private:
+      enum : size_t
+      {
+         EndIndex = ~size_t( 0 )
+      };
+
+      LazyCache( const std::shared_ptr<_State>& state, size_t index ) :
+         _state( state ),
+         _index( index )
+      {
+      }
+
+      std::shared_ptr<_State> _state;
+      size_t _index;
+   };
+
+   template<typename _ValType,
+            typename _Range,
+            typename _Iter>
+   class LazyRange;
+
+   //! \brief Pushes all elements of a range into the sink by iterating it
+   //! \returns False if the sink stopped the evaluation
+   template<typename _Range, typename _Sink>
+   bool _PushRange( const _Range& range, _Sink& sink )
+   {
+      for ( auto cur = std::begin( range ), end = std::end( range ); cur != end; ++cur )
+      {
+         if ( !sink( *cur ) ) return false;
+      }
+      return true;
+   }
+
+   //! \brief LazyRanges are pushed through their own operations instead of being iterated
+   template<typename _ValType, typename _Range, typename _Iter, typename _Sink>
+   bool _PushRange( const LazyRange<_ValType, _Range, _Iter>& range, _Sink& sink )
+   {
+      return range.Push( sink );
+   }
+
+   //! \brief Stores a value of type _Type, or only a pointer if _Type is an lvalue reference
+   template<typename _Type>
+   struct _Held
+   {
+      using _StorageType = _Type;
+
+      template<typename _Val>
+      static _Type Make( _Val&& val )
+      {
+         return std::forward<_Val>( val );
+      }
+
+      static const _Type& Get( const _StorageType& held )
+      {
+         return held;
+      }
+   };
+
+   template<typename _Type>
+   struct _Held<_Type&>
+   {
+      using _StorageType = _Type*;
+
+      static _StorageType Make( _Type& val )
+      {
+         return &val;
+      }
+
+      static const _Type& Get( const _StorageType& held )
+      {
+         return *held;
+      }
+   };
+
+   //! \brief Type of the range that a flat map function of type _Fn returns for an element of type _Src.
+   //!        This is a reference if the function returns an lvalue reference, e.g. to a member of the element
+   template<typename _Fn, typename _Src>
+   using _FlatMapRange = typename std::conditional<std::is_lvalue_reference<decltype( std::declval<const _Fn&>()( std::declval<const _Src&>() ) )>::value,
+                                                   decltype( std::declval<const _Fn&>()( std::declval<const _Src&>() ) ),
+                                                   _MapResult<_Fn, _Src>>::type;
+
+   //! \brief Value type of the elements of a range of type _Range
+   template<typename _Range>
+   using _RangeValue = typename std::decay<decltype( *std::begin( std::declval<const typename std::remove_reference<_Range>::type&>() ) )>::type;
+
+   //! \brief Lazy iterator that maps each element to a range and iterates the elements of all these ranges
+   //!
+   //! Only the range of the current element is kept. Ranges that the function returns by reference are not
+   //! copied, and if the function returns a LazyRange, Push evaluates it with its own operations
+   //! \tparam _SrcType Value type of the nested iterator
+   //! \tparam _DstType Value type of the ranges returned by the function
+   //! \tparam _Iter Type of the nested iterator
+   //! \tparam _Fn Type of the function that maps an element to a range
+   template<typename _SrcType,
+            typename _DstType,
+            typename _Iter,
+            typename _Fn>
+   class LazyFlatMap : public std::iterator<std::forward_iterator_tag, _DstType>
+   {
+      using _InnerRange = _FlatMapRange<_Fn, _SrcType>;
+      using _RangeType = typename std::remove_cv<typename std::remove_reference<_InnerRange>::type>::type;
+      using _InnerIter = decltype( std::begin( std::declval<const _RangeType&>() ) );
+
+      //! \brief The current element together with its range, which all copies of an iterator share
+      //!
+      //! The element is kept alive as well, as the range may refer to it. Neither is copied if the nested
+      //! iterator and the function return references
+      class _Expansion
+      {
+         using _Element = _IterReference<_Iter>;
+      public:
+         _Expansion( const _Fn& fn, const _Iter& cur ) :
+            _element( _Held<_Element>::Make( *cur ) ),
+            _range( _Held<_InnerRange>::Make( fn( _Held<_Element>::Get( _element ) ) ) ),
+            _end( std::end( _Held<_InnerRange>::Get( _range ) ) )
+         {
+         }
+
+         _Expansion( const _Expansion& ) = delete;
+         _Expansion& operator=( const _Expansion& ) = delete;
+
+         _InnerIter Begin() const
+         {
+            return std::begin( _Held<_InnerRange>::Get( _range ) );
+         }
+
+         _InnerIter End() const
+         {
+            return _end;
+         }
+      private:
+         typename _Held<_Element>::_StorageType _element;
+         typename _Held<_InnerRange>::_StorageType _range;
+         _InnerIter _end;
+      };
+   public:
+      using _IterType = LazyFlatMap;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! Each source element is expanded on its own, so chunks of the source can be expanded independently
+      using _Splittable = typename _SourceAccess<_Iter>::_Splittable;
+      //! The number of elements is only known after expanding every element
+      using _SizeKnown = std::false_type;
+      using _Vectorizable = std::false_type;
+
+      LazyFlatMap( _Iter begin,
+                   _Iter end,
+                   _Iter cur,
+                   const _Fn& fn ) :
+         _nested( begin, end, cur ),
+         _state( _State{ fn } ),
+         _index( 0 )
+      {
+      }
+
+      LazyFlatMap& operator++( )
+      {
+         if ( IsAtEnd() ) return *this;
+         ++*_inner;
+         ++_index;
+         if ( *_inner == ( *_expansion )->End() )
+         {
+            ++_nested.cur;
+            Expand();
+         }
+         return *this;
+      }
+
+      //! \brief Returns the current element of the range of the current element as it is, i.e. without
+      //!        copying it if the range is a container
+      _IterReference<_InnerIter> operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return **_inner;
+      }
+
+      //! \brief Iterators of the same range only differ in their position
+      bool operator==( const LazyFlatMap& other ) const
+      {
+         return _nested.cur == other._nested.cur && _index == other._index;
+      }
+
+      bool operator!=( const LazyFlatMap& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _nested.AtEnd();
+      }
+
+      LazyFlatMap begin() const
+      {
+         LazyFlatMap begin( _nested.At( _SourceAccess<_Iter>::First( _nested.Begin() ) ), _state );
+         begin.Expand();
+         return begin;
+      }
+
+      LazyFlatMap end() const
+      {
+         return LazyFlatMap( _nested.At( _nested.End() ), _state );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyFlatMap UnevaluatedBegin() const
+      {
+         return LazyFlatMap( _nested.At( _nested.Begin() ), _state );
+      }
+
+      _SourceIterType SourceBegin() const
+      {
+         return _SourceAccess<_Iter>::Begin( _nested.Begin(), _nested.End() );
+      }
+
+      _SourceIterType SourceEnd() const
+      {
+         return _SourceAccess<_Iter>::End( _nested.Begin(), _nested.End() );
+      }
+
+      //! \brief Returns this operation applied to the given subrange of the source container
+      //! \param first Begin of the subrange
+      //! \param last End of the subrange
+      LazyFlatMap Rebase( _SourceIterType first, _SourceIterType last ) const
+      {
+         auto nested = _SourceAccess<_Iter>::Rebase( _nested.Begin(), first, last );
+         return LazyFlatMap( _Nested<_Iter>( nested.first, nested.second, nested.first ), _state );
+      }
+
+      //! \brief The ranges of the elements can have any size, so there is no upper bound
+      size_t SizeHint() const
+      {
+         return ~size_t( 0 );
+      }
+
+      //! \brief Pushes all elements of this range into the sink
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         const auto& fn = _state->fn;
+         auto flatMap = [&fn, &sink] ( const _SrcType& val )
+         {
+            return _PushRange( fn( val ), sink );
+         };
+         return _SourceAccess<_Iter>::Push( _nested.Begin(), _nested.End(), flatMap );
+      }
+   private:
+      //! \brief Function, which all iterators of the range and its rebased copies share instead of copying it
+      struct _State
+      {
+         _Fn fn;
+      };
+
+      LazyFlatMap( const _Nested<_Iter>& nested, const _Shared<_State>& state ) :
+         _nested( nested ),
+         _state( state ),
+         _index( 0 )
+      {
+      }
+
+      //! \brief Moves to the first element of the range of the current element, skipping empty ranges
+      void Expand()
+      {
+         _index = 0;
+         while ( !IsAtEnd() )
+         {
+            //An expansion that no copy shares any more is reused, so that iterating allocates it only once
+            if ( !_expansion || _expansion.use_count() > 1 ) _expansion = std::make_shared<std::optional<_Expansion>>();
+            _expansion->emplace( _state->fn, _nested.cur );
+            _inner = ( *_expansion )->Begin();
+            if ( *_inner != ( *_expansion )->End() ) return;
+            ++_nested.cur;
+         }
+         _expansion.reset();
+         _inner.reset();
+      }
+
+      _Nested<_Iter> _nested;
+      _Shared<_State> _state;
+      //! The current element and its range, empty at the end and before the first element is evaluated
+      std::shared_ptr<std::optional<_Expansion>> _expansion;
+      //! Position in the range of the current element, as lazy iterators cannot be default constructed
+      std::optional<_InnerIter> _inner;
+      size_t _index;
+   };
+
+   //! \brief Lazy iterator that iterates the elements of one range followed by the elements of another range
+   //! \tparam _ValType Value type of the iterator
+   //! \tparam _Iter Type of the nested iterator of the first range
+   //! \tparam _OtherIter Type of the nested iterator of the second range
+   template<typename _ValType,
+            typename _Iter,
+            typename _OtherIter>
+   class LazyConcat : public std::iterator<std::forward_iterator_tag, _ValType>
+   {
+   public:
+      using _IterType = LazyConcat;
+      using _Reference = typename std::conditional<std::is_same<_IterReference<_Iter>, _IterReference<_OtherIter>>::value,
+                                                   _IterReference<_Iter>,
+                                                   _ValType>::type;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! The ranges have different sources, so they can't be split into chunks of a single source
+      using _Splittable = std::false_type;
+      using _SizeKnown = std::integral_constant<bool, _SourceAccess<_Iter>::_SizeKnown::value &&
+                                                     _SourceAccess<_OtherIter>::_SizeKnown::value>;
+      using _Vectorizable = std::false_type;
+
+      LazyConcat( _Iter begin, _Iter end, _OtherIter otherBegin, _OtherIter otherEnd ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( begin ),
+         _otherBegin( otherBegin ),
+         _otherEnd( otherEnd )
+      {
+      }
+
+      LazyConcat( const LazyConcat& other ) = default;
+
+      LazyConcat& operator++( )
+      {
+         if ( _otherCur )
+         {
+            if ( *_otherCur != _otherEnd ) ++*_otherCur;
+            return *this;
+         }
+         ++_cur;
+         if ( _cur == _end ) EnterOther();
+         return *this;
+      }
+
+      //! \brief Returns the current element without copying it, if both ranges return the same type of reference
+      _Reference operator*( ) const
+      {
+         if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         if ( _otherCur ) return **_otherCur;
+         return *_cur;
+      }
+
+      bool operator==( const LazyConcat& other ) const
+      {
+         bool atEnd = IsAtEnd();
+         if ( atEnd || other.IsAtEnd() ) return atEnd == other.IsAtEnd();
+         if ( _otherCur ) return other._otherCur && *_otherCur == *other._otherCur;
+         return !other._otherCur && _cur == other._cur;
+      }
+
+      bool operator!=( const LazyConcat& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _otherCur && *_otherCur == _otherEnd;
+      }
+
+      LazyConcat begin() const
+      {
+         LazyConcat begin( _begin, _end, _SourceAccess<_Iter>::First( _begin ), _otherBegin, _otherEnd );
+         if ( begin._cur == _end ) begin.EnterOther();
+         return begin;
+      }
+
+      LazyConcat end() const
+      {
+         LazyConcat end( _begin, _end, _end, _otherBegin, _otherEnd );
+         end._otherCur.emplace( _otherEnd );
+         return end;
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyConcat UnevaluatedBegin() const
+      {
+         return LazyConcat( _begin, _end, _otherBegin, _otherEnd );
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         size_t size = _SourceAccess<_Iter>::SizeHint( _begin, _end );
+         size_t otherSize = _SourceAccess<_OtherIter>::SizeHint( _otherBegin, _otherEnd );
+         return size + otherSize < size ? ~size_t( 0 ) : size + otherSize;
+      }
+
+      //! \brief Pushes all elements of the first range and then all elements of the second range into the sink
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         return _SourceAccess<_Iter>::Push( _begin, _end, sink ) &&
+                _SourceAccess<_OtherIter>::Push( _otherBegin, _otherEnd, sink );
+      }
+   private:
+      LazyConcat( _Iter begin, _Iter end, _Iter cur, _OtherIter otherBegin, _OtherIter otherEnd ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( cur ),
+         _otherBegin( otherBegin ),
+         _otherEnd( otherEnd )
+      {
+      }
+
+      //! \brief The second range is only evaluated once the first range is exhausted
+      void EnterOther()
+      {
+         _otherCur.emplace( _SourceAccess<_OtherIter>::First( _otherBegin ) );
+      }
+
+      _Iter _begin;
+      _Iter _end;
+      _Iter _cur;
+      _OtherIter _otherBegin;
+      _OtherIter _otherEnd;
+      //! Position in the second range, only set once the first range is exhausted
+      std::optional<_OtherIter> _otherCur;
+   };
+
+   //! \brief View over the elements of a chunk or a window
+   //!
+   //! The elements are stored in a buffer that belongs to the Chunk or Window operation, the view only refers
+   //! to it. A view is valid until the operation produces its next element, so aggregate the elements of a
+   //! view instead of storing the view itself
+   //! \tparam _ValType Type of the elements
+   template<typename _ValType>
+   class BufferView
+   {
+   public:
+      using value_type = _ValType;
+      using size_type = size_t;
+      using const_iterator = const _ValType*;
+      using iterator = const_iterator;
+
+      BufferView() :
+         _data( nullptr ),
+         _size( 0 )
+      {
+      }
+
+      BufferView( const _ValType* data, size_t size ) :
+         _data( data ),
+         _size( size )
+      {
+      }
+
+      const _ValType& operator[]( size_t index ) const
+      {
+         return _data[index];
+      }
+
+      const _ValType* data() const
+      {
+         return _data;
+      }
+
+      size_t size() const
+      {
+         return _size;
+      }
+
+      bool empty() const
+      {
+         return _size == 0;
+      }
+
+      const _ValType& front() const
+      {
+         return _data[0];
+      }
+
+      const _ValType& back() const
+      {
+         return _data[_size - 1];
+      }
+
+      const_iterator begin() const
+      {
+         return _data;
+      }
+
+      const_iterator end() const
+      {
+         return _data + _size;
+      }
+   private:
+      const _ValType* _data;
+      size_t _size;
+   };
+
+   //! \brief Lazy iterator that groups consecutive elements into chunks of a fixed size
+   //!
+   //! The last chunk contains the remaining elements and may be smaller. All chunks share a single buffer,
+   //! which is allocated once per iteration
+   //! \tparam _ValType Value type of the nested iterator
+   //! \tparam _Iter Type of the nested iterator
+   template<typename _ValType,
+            typename _Iter>
+   class LazyChunk : public std::iterator<std::forward_iterator_tag, BufferView<_ValType>>
+   {
+   public:
+      using _IterType = LazyChunk;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! Chunks would be cut at the borders of the source chunks, so this can't be split
+      using _Splittable = std::false_type;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::false_type;
+
+      LazyChunk( _Iter begin, _Iter end, _Iter cur, size_t size ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( cur ),
+         _size( size ),
+         _atEnd( false )
+      {
+      }
+
+      LazyChunk( const LazyChunk& other ) = default;
+
+      LazyChunk& operator++( )
+      {
+         if ( _atEnd ) return *this;
+         //_cur is at the last element of the current chunk, unless the nested range ended in this chunk
+         _buffer.clear();
+         if ( _cur != _end ) ++_cur;
+         Fill();
+         return *this;
+      }
+
+      BufferView<_ValType> operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( _atEnd ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return BufferView<_ValType>( _buffer.data(), _buffer.size() );
+      }
+
+      bool operator==( const LazyChunk& other ) const
+      {
+         if ( _atEnd || other._atEnd ) return _atEnd == other._atEnd;
+         return _cur == other._cur;
+      }
+
+      bool operator!=( const LazyChunk& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _atEnd;
+      }
+
+      LazyChunk begin() const
+      {
+         LazyChunk begin( _begin, _end, _SourceAccess<_Iter>::First( _begin ), _size );
+         begin._buffer.reserve( _size );
+         begin.Fill();
+         return begin;
+      }
+
+      LazyChunk end() const
+      {
+         LazyChunk end( _begin, _end, _end, _size );
+         end._atEnd = true;
+         return end;
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyChunk UnevaluatedBegin() const
+      {
+         return LazyChunk( _begin, _end, _begin, _size );
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         size_t nested = _SourceAccess<_Iter>::SizeHint( _begin, _end );
+         if ( nested == ~size_t( 0 ) ) return nested;
+         return ( nested + _size - 1 ) / _size;
+      }
+
+      //! \brief Pushes all chunks of this range into the sink
+      //! \param sink Called with a view on each chunk, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         std::vector<_ValType> buffer;
+         buffer.reserve( _size );
+         auto chunk = [this, &sink, &buffer] ( auto&& val )
+         {
+            buffer.push_back( std::forward<decltype( val )>( val ) );
+            if ( buffer.size() < _size ) return true;
+            bool accepting = sink( BufferView<_ValType>( buffer.data(), _size ) );
+            buffer.clear();
+            return accepting;
+         };
+         if ( !_SourceAccess<_Iter>::Push( _begin, _end, chunk ) ) return false;
+         return buffer.empty() || sink( BufferView<_ValType>( buffer.data(), buffer.size() ) );
+      }
+   private:
+      //! \brief Reads the elements of the next chunk, starting at _cur
+      void Fill()
+      {
+         while ( _cur != _end )
+         {
+            _buffer.push_back( *_cur );
+            if ( _buffer.size() == _size ) break;
+            ++_cur;
+         }
+         _atEnd = _buffer.empty();
+      }
+
+      _Iter _begin;
+      _Iter _end;
+      _Iter _cur;
+      size_t _size;
+      std::vector<_ValType> _buffer;
+      bool _atEnd;
+   };
+
+   //! \brief Lazy iterator that slides a window of a fixed size over the elements
+   //!
+   //! Each step moves the window by one element, ranges with less elements than the window size have no
+   //! windows. The window is a view over a ring buffer, so each step only copies the new element. The ring
+   //! buffer holds every element twice, once in each half, so that each window is contiguous in memory
+   //! \tparam _ValType Value type of the nested iterator
+   //! \tparam _Iter Type of the nested iterator
+   template<typename _ValType,
+            typename _Iter>
+   class LazyWindow : public std::iterator<std::forward_iterator_tag, BufferView<_ValType>>
+   {
+   public:
+      using _IterType = LazyWindow;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! Windows overlap the borders of the source chunks, so this can't be split
+      using _Splittable = std::false_type;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::false_type;
+
+      LazyWindow( _Iter begin, _Iter end, _Iter cur, size_t size ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( cur ),
+         _size( size ),
+         _head( 0 ),
+         _atEnd( false )
+      {
+      }
+
+      LazyWindow( const LazyWindow& other ) = default;
+
+      LazyWindow& operator++( )
+      {
+         if ( _atEnd ) return *this;
+         //_cur is at the newest element of the current window, so the nested iterator is not evaluated
+         //ahead of the window
+         ++_cur;
+         if ( _cur == _end )
+         {
+            _atEnd = true;
+            return *this;
+         }
+         Replace( _ring, _head, *_cur, _size );
+         return *this;
+      }
+
+      BufferView<_ValType> operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( _atEnd ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return BufferView<_ValType>( _ring.data() + _head, _size );
+      }
+
+      bool operator==( const LazyWindow& other ) const
+      {
+         if ( _atEnd || other._atEnd ) return _atEnd == other._atEnd;
+         return _cur == other._cur;
+      }
+
+      bool operator!=( const LazyWindow& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _atEnd;
+      }
+
+      LazyWindow begin() const
+      {
+         LazyWindow begin( _begin, _end, _SourceAccess<_Iter>::First( _begin ), _size );
+         begin._ring.reserve( 2 * _size );
+         begin.Fill();
+         return begin;
+      }
+
+      LazyWindow end() const
+      {
+         LazyWindow end( _begin, _end, _end, _size );
+         end._atEnd = true;
+         return end;
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyWindow UnevaluatedBegin() const
+      {
+         return LazyWindow( _begin, _end, _begin, _size );
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         size_t nested = _SourceAccess<_Iter>::SizeHint( _begin, _end );
+         if ( nested == ~size_t( 0 ) ) return nested;
+         return nested < _size ? 0 : nested - _size + 1;
+      }
+
+      //! \brief Pushes all windows of this range into the sink
+      //! \param sink Called with a view on each window, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         std::vector<_ValType> ring;
+         ring.reserve( 2 * _size );
+         size_t head = 0;
+         auto window = [this, &sink, &ring, &head] ( const _ValType& val )
+         {
+            if ( ring.size() < _size )
+            {
+               ring.push_back( val );
+               if ( ring.size() < _size ) return true;
+               Mirror( ring );
+            }
+            else
+            {
+               Replace( ring, head, val, _size );
+            }
+            return sink( BufferView<_ValType>( ring.data() + head, _size ) );
+         };
+         return _SourceAccess<_Iter>::Push( _begin, _end, window );
+      }
+   private:
+      //! \brief Reads the elements of the first window
+      void Fill()
+      {
+         while ( _cur != _end )
+         {
+            _ring.push_back( *_cur );
+            if ( _ring.size() == _size ) break;
+            ++_cur;
+         }
+         _atEnd = _ring.size() < _size;
+         if ( !_atEnd ) Mirror( _ring );
+      }
+
+      //! \brief Copies the elements of the first window into the second half of the ring buffer
+      static void Mirror( std::vector<_ValType>& ring )
+      {
+         for ( size_t i = 0, size = ring.size(); i < size; i++ ) ring.push_back( ring[i] );
+      }
+
+      //! \brief Replaces the oldest element of the window with the given element in both halves of the
+      //!        ring buffer, which moves the window by one element
+      static void Replace( std::vector<_ValType>& ring, size_t& head, const _ValType& val, size_t size )
+      {
+         ring[head] = val;
+         ring[head + size] = val;
+         head = head + 1 == size ? 0 : head + 1;
+      }
+
+      _Iter _begin;
+      _Iter _end;
+      _Iter _cur;
+      size_t _size;
+      std::vector<_ValType> _ring;
+      size_t _head;
+      bool _atEnd;
+   };
+
+   //! \brief Lazy iterator that sorts the elements of the nested range by a key
+   //!
+   //! The nested range is evaluated into a single buffer once iteration starts and the buffer is sorted, the
+   //! order of elements with equal keys is unspecified. If the range is limited to fewer elements than the
+   //! nested range has, only the smallest elements are kept in a bounded heap instead, which takes O(n log k)
+   //! time and O(k) memory for a limit of k
+   //! \tparam _ValType Value type of the iterator
+   //! \tparam _Iter Type of the nested iterator
+   //! \tparam _KeyFn Type of the function that returns the key of an element
+   //! \tparam _Compare Comparison of the keys, std::less for ascending and std::greater for descending order
+   template<typename _ValType,
+            typename _Iter,
+            typename _KeyFn,
+            typename _Compare>
+   class LazyOrderBy : public std::iterator<std::forward_iterator_tag, _ValType>
+   {
+   public:
+      using _IterType = LazyOrderBy;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! All elements have to be known before the first one, so this can't be split into chunks
+      using _Splittable = std::false_type;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::false_type;
+
+      LazyOrderBy( _Iter begin, _Iter end, const _KeyFn& keyFn, size_t limit = ~size_t( 0 ) ) :
+         _begin( begin ),
+         _end( end ),
+         _state( _State{ keyFn } ),
+         _limit( limit ),
+         _index( 0 )
+      {
+      }
+
+      const _ValType& operator*( ) const
+      {
+         if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         return ( *_values )[_index];
+      }
+
+      LazyOrderBy& operator++( )
+      {
+         if ( !IsAtEnd() ) ++_index;
+         return *this;
+      }
+
+      bool operator==( const LazyOrderBy& other ) const
+      {
+         bool atEnd = IsAtEnd();
+         if ( atEnd || other.IsAtEnd() ) return atEnd == other.IsAtEnd();
+         return _values == other._values &&
+                _index == other._index;
+      }
+
+      bool operator!=( const LazyOrderBy& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return !_values || _index == _values->size();
+      }
+
+      LazyOrderBy begin() const
+      {
+         LazyOrderBy begin( _begin, _end, _state, _limit );
+         begin._values = std::make_shared<const std::vector<_ValType>>( Evaluate() );
+         return begin;
+      }
+
+      LazyOrderBy end() const
+      {
+         return LazyOrderBy( _begin, _end, _state, _limit );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyOrderBy UnevaluatedBegin() const
+      {
+         return end();
+      }
+
+      //! \brief Returns this operation limited to the given number of elements, which turns the sort into a
+      //!        bounded heap
+      LazyOrderBy Limited( size_t limit ) const
+      {
+         return LazyOrderBy( _begin, _end, _state, std::min( limit, _limit ) );
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         return std::min( _limit, _SourceAccess<_Iter>::SizeHint( _begin, _end ) );
+      }
+
+      //! \brief Pushes all elements of this range into the sink, in order
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         for ( auto& val : Evaluate() )
+         {
+            if ( !sink( val ) ) return false;
+         }
+         return true;
+      }
+   private:
+      //! \brief Key function, which all iterators of the range and its limited copies share instead of copying it
+      struct _State
+      {
+         _KeyFn keyFn;
+      };
+
+      LazyOrderBy( _Iter begin, _Iter end, const _Shared<_State>& state, size_t limit ) :
+         _begin( begin ),
+         _end( end ),
+         _state( state ),
+         _limit( limit ),
+         _index( 0 )
+      {
+      }
+
+      //! \brief Evaluates the nested range and returns its ordered elements, up to the limit
+      std::vector<_ValType> Evaluate() const
+      {
+         const auto& keyFn = _state->keyFn;
+         auto less = [&keyFn] ( const _ValType& l, const _ValType& r )
+         {
+            return _Compare()( keyFn( l ), keyFn( r ) );
+         };
+
+         std::vector<_ValType> values;
+         size_t sizeHint = _SourceAccess<_Iter>::SizeHint( _begin, _end );
+         if ( _limit < sizeHint )
+         {
+            if ( _limit == 0 ) return values;
+
+            //The heap keeps the smallest elements seen so far, with the largest of them on top
+            values.reserve( _limit );
+            auto heap = [this, &values, &less] ( auto&& val )
+            {
+               if ( values.size() < _limit )
+               {
+                  values.push_back( std::forward<decltype( val )>( val ) );
+                  std::push_heap( values.begin(), values.end(), less );
+               }
+               else if ( less( val, values.front() ) )
+               {
+                  std::pop_heap( values.begin(), values.end(), less );
+                  values.back() = std::forward<decltype( val )>( val );
+                  std::push_heap( values.begin(), values.end(), less );
+               }
+               return true;
+            };
+            _SourceAccess<_Iter>::Push( _begin, _end, heap );
+            std::sort_heap( values.begin(), values.end(), less );
+            return values;
+         }
+
+         if ( _SizeKnown::value ) values.reserve( sizeHint );
+         auto append = [&values] ( auto&& val )
+         {
+            values.push_back( std::forward<decltype( val )>( val ) );
+            return true;
+         };
+         _SourceAccess<_Iter>::Push( _begin, _end, append );
+         std::sort( values.begin(), values.end(), less );
+         if ( values.size() > _limit ) values.erase( values.begin() + _limit, values.end() );
+         return values;
+      }
+
+      _Iter _begin;
+      _Iter _end;
+      _Shared<_State> _state;
+      size_t _limit;
+      std::shared_ptr<const std::vector<_ValType>> _values;
+      size_t _index;
+   };
+
+   //! \brief Lazy iterator that evaluates the nested range on a thread of its own
+   //!
+   //! Iterating the range starts a thread that pushes the elements of the nested range into a bounded
+   //! single-producer/single-consumer queue, from which this iterator takes them in order. The nested range is
+   //! evaluated ahead of the consumer by up to the capacity of the queue. Chaining several of these, e.g. one
+   //! after each expensive map, runs each part of the chain on its own thread. In contrast to the Parallel
+   //! policy, this does not need a source that can be split into chunks.
+   //!
+   //! Copies of an iterator share the position in the queue, so each begin() can only be iterated once. When
+   //! the last copy is destroyed, the thread is stopped. Exceptions of the nested range are rethrown where the
+   //! next element is requested
+   //! \tparam _ValType Value type of the nested iterator
+   //! \tparam _Iter Type of the nested iterator
+   template<typename _ValType,
+            typename _Iter>
+   class LazyPipelined : public std::iterator<std::input_iterator_tag, _ValType, ptrdiff_t, const _ValType*, const _ValType&>
+   {
+      //! \brief Queue between the thread that evaluates the nested range and the consumer
+      struct _Channel
+      {
+         _Channel( size_t capacity ) :
+            queue( capacity ),
+            stop( false ),
+            done( false ),
+            wakeBatch( std::max( queue.Capacity() / 4, size_t( 1 ) ) ),
+            pushedSinceWake( 0 ),
+            poppedSinceWake( 0 )
+         {
+         }
+
+         ~_Channel()
+         {
+            stop.store( true, std::memory_order_relaxed );
+            Notify();
+            if ( producer.joinable() ) producer.join();
+         }
+
+         //! \brief Waits for the next element
+         //! \returns The next element, which stays in the queue until it is popped, or nullptr at the end
+         _ValType* Next()
+         {
+            _ValType* front = nullptr;
+            Wait( [this, &front] () { return ( front = queue.Front() ) != nullptr || done.load( std::memory_order_acquire ); } );
+            if ( front ) return front;
+            //The producer may have pushed more elements before it finished
+            if ( ( front = queue.Front() ) ) return front;
+            if ( error ) std::rethrow_exception( error );
+            return nullptr;
+         }
+
+         //! \brief Removes the element returned by Next
+         void Pop()
+         {
+            queue.Pop();
+            Progress( poppedSinceWake );
+         }
+
+         //! \brief Waits until ready returns true, i.e. until the other thread made progress
+         //!
+         //! The other thread is usually about to make progress, so this yields a few times before it sleeps. A
+         //! consumer that waits for an expensive nested range thus does not keep a core busy
+         template<typename _Ready>
+         void Wait( const _Ready& ready )
+         {
+            for ( int i = 0; i < 64; i++ )
+            {
+               if ( ready() ) return;
+               std::this_thread::yield();
+            }
+            //The other thread may sleep as well, waiting for progress of this one that was not signaled yet
+            Notify();
+            std::unique_lock<std::mutex> lock( mutex );
+            sleeping.fetch_add( 1, std::memory_order_relaxed );
+            //Pairs with the fence in Notify: either the other thread sees the sleeper, or ready sees its progress
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            changed.wait( lock, ready );
+            sleeping.fetch_sub( 1, std::memory_order_relaxed );
+         }
+
+         //! \brief Counts a step of progress of the calling thread and wakes up the other thread once per batch
+         //!
+         //! Waking a thread takes far longer than evaluating a cheap element. A sleeping thread therefore is only
+         //! woken once a quarter of the queue was filled or emptied since the last wake, or when the other
+         //! thread has to wait itself, finishes or stops
+         void Progress( size_t& sinceWake )
+         {
+            if ( ++sinceWake < wakeBatch ) return;
+            sinceWake = 0;
+            Notify();
+         }
+
+         //! \brief Wakes up the other thread if it sleeps in Wait. Only locks if it does
+         void Notify()
+         {
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            if ( sleeping.load( std::memory_order_relaxed ) == 0 ) return;
+            {
+               std::lock_guard<std::mutex> lock( mutex );
+            }
+            changed.notify_all();
+         }
+
+         Threading::SpscQueue<_ValType> queue;
+         //! Set by the consumer once it does not accept more elements
+         std::atomic<bool> stop;
+         //! Set by the producer once the nested range is evaluated
+         std::atomic<bool> done;
+         std::exception_ptr error;
+         std::thread producer;
+         std::mutex mutex;
+         std::condition_variable changed;
+         //! Number of threads that sleep in Wait
+         std::atomic<int> sleeping{ 0 };
+         const size_t wakeBatch;
+         //! Progress of the producer and of the consumer since they last woke the other thread
+         size_t pushedSinceWake;
+         size_t poppedSinceWake;
+      };
+
+      //! \brief State of an iteration, shared by the copies of an iterator
+      struct _Stream
+      {
+         std::unique_ptr<_Channel> channel;
+         _ValType* current;
+      };
+   public:
+      using _IterType = LazyPipelined;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! The elements arrive in order through a single queue, so this can't be split into chunks
+      using _Splittable = std::false_type;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = std::false_type;
+
+      LazyPipelined( _Iter begin, _Iter end, size_t capacity ) :
+         _begin( begin ),
+         _end( end ),
+         _capacity( capacity )
+      {
+      }
+
+      const _ValType& operator*( ) const
+      {
+         if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         return *_stream->current;
+      }
+
+      LazyPipelined& operator++( )
+      {
+         if ( !IsAtEnd() )
+         {
+            _stream->channel->Pop();
+            _stream->current = _stream->channel->Next();
+         }
+         return *this;
+      }
+
+      bool operator==( const LazyPipelined& other ) const
+      {
+         bool atEnd = IsAtEnd();
+         if ( atEnd || other.IsAtEnd() ) return atEnd == other.IsAtEnd();
+         return _stream == other._stream;
+      }
+
+      bool operator!=( const LazyPipelined& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return !_stream || !_stream->current;
+      }
+
+      //! \brief Starts evaluating the nested range on a new thread
+      LazyPipelined begin() const
+      {
+         LazyPipelined begin( _begin, _end, _capacity );
+         begin._stream = std::make_shared<_Stream>();
+         begin._stream->channel = Start();
+         begin._stream->current = begin._stream->channel->Next();
+         return begin;
+      }
+
+      LazyPipelined end() const
+      {
+         return LazyPipelined( _begin, _end, _capacity );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyPipelined UnevaluatedBegin() const
+      {
+         return end();
+      }
+
+      //! \brief Upper bound on the number of elements in this range, exact if _SizeKnown
+      size_t SizeHint() const
+      {
+         return _SourceAccess<_Iter>::SizeHint( _begin, _end );
+      }
+
+      //! \brief Pushes all elements of this range into the sink. The elements are evaluated on another thread
+      //!        and passed to the sink on the calling thread, in order
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         auto channel = Start();
+         while ( auto val = channel->Next() )
+         {
+            bool accepting = sink( std::move( *val ) );
+            channel->Pop();
+            if ( !accepting ) return false;
+         }
+         return true;
+      }
+
+      //! \brief Returns this operation over the nested range limited to the given number of elements. This has
+      //!        the same elements as a limit after this operation, but the thread stops at the limit instead of
+      //!        evaluating up to the capacity of the queue ahead
+      template<typename _Limited = typename _LimitStage<_ValType, _Iter>::_Type>
+      LazyPipelined<_ValType, _Limited> Limited( size_t limit ) const
+      {
+         auto limited = _LimitStage<_ValType, _Iter>::Make( _begin, _end, limit );
+         return LazyPipelined<_ValType, _Limited>( limited.UnevaluatedBegin(), limited.end(), _capacity );
+      }
+
+#ifdef LAZY_INSTRUMENTATION
+      //! \brief Appends the reports of the nested operations, which are evaluated on the thread of this operation
+      void CollectReports( std::vector<StageReport>& reports ) const
+      {
+         _CollectReports( _begin, reports, 0 );
+      }
+#endif
+   private:
+      //! \brief Creates a channel and starts the thread that pushes the elements of the nested range into it
+      std::unique_ptr<_Channel> Start() const
+      {
+         std::unique_ptr<_Channel> channel( new _Channel( _capacity ) );
+         _Channel* target = channel.get();
+         _Iter begin = _begin;
+         _Iter end = _end;
+         //The channel joins the thread before it is destroyed, so the thread can keep a plain pointer to it
+         channel->producer = std::thread( [target, begin, end] ()
+         {
+            try
+            {
+               auto send = [target] ( auto&& val )
+               {
+                  //TryPush only moves from the element if it appends it, so it can be tried again
+                  bool pushed = false;
+                  target->Wait( [target, &val, &pushed] ()
+                  {
+                     pushed = target->queue.TryPush( std::forward<decltype( val )>( val ) );
+                     return pushed || target->stop.load( std::memory_order_relaxed );
+                  } );
+                  if ( !pushed ) return false;
+                  target->Progress( target->pushedSinceWake );
+                  return !target->stop.load( std::memory_order_relaxed );
+               };
+               _SourceAccess<_Iter>::Push( begin, end, send );
+            }
+            catch ( ... )
+            {
+               target->error = std::current_exception();
+            }
+            target->done.store( true, std::memory_order_release );
+            target->Notify();
+         } );
+         return channel;
+      }
+
+      _Iter _begin;
+      _Iter _end;
+      size_t _capacity;
+      std::shared_ptr<_Stream> _stream;
+   };
+
+   //! \brief Option for Distinct that puts a Bloom filter in front of the set of keys
+   //!
+   //! For a key that the filter has definitely not seen, the key is inserted into the set without comparing it
+   //! to any other key. This pays off for large ranges with mostly unique keys, especially if comparing keys is
+   //! expensive, e.g. for long strings
+   struct BloomPrefilter
+   {
+      //! \param expectedCount Expected number of distinct keys, zero for no filter
+      //! \param falsePositiveRate Fraction of new keys that the filter takes as possibly seen, once
+      //!                          expectedCount keys were seen
+      explicit BloomPrefilter( size_t expectedCount, double falsePositiveRate = 0.01 ) :
+         expectedCount( expectedCount ),
+         falsePositiveRate( falsePositiveRate )
+      {
+      }
+
+      size_t expectedCount;
+      double falsePositiveRate;
+   };
+
+   //! \brief Key function of Distinct, the elements are their own keys
+   struct _Identity
+   {
+      template<typename T>
+      const T& operator()( const T& val ) const
+      {
+         return val;
+      }
+   };
+
+   //! \brief Lazy iterator that skips elements whose key was already seen
+   //!
+   //! Only the first element of each key is kept, in the order of the nested range. The keys that were seen are
+   //! kept in a flat hash set, optionally behind a Bloom filter. Copies of an iterator share the set, so each
+   //! begin() can only be iterated once
+   //! \tparam _ValType Value type of the iterator
+   //! \tparam _Iter Type of the nested iterator
+   //! \tparam _KeyFn Type of the function that returns the key of an element
+   template<typename _ValType,
+            typename _Iter,
+            typename _KeyFn>
+   class LazyDistinct : public std::iterator<std::input_iterator_tag, _ValType, ptrdiff_t, const _ValType*, _IterReference<_Iter>>
+   {
+      using _Key = _MapResult<_KeyFn, _ValType>;
+
+      //! \brief The keys that were seen
+      class _Seen
+      {
+      public:
+         explicit _Seen( const BloomPrefilter& prefilter )
+         {
+            if ( !prefilter.expectedCount ) return;
+            _bloom.reset( new Containers::BloomFilter( prefilter.expectedCount, prefilter.falsePositiveRate ) );
+            _keys.Reserve( prefilter.expectedCount );
+         }
+
+         //! \returns True if the key was not seen before
+         bool Insert( const _Key& key )
+         {
+            if ( !_bloom ) return _keys.Insert( key );
+
+            size_t hash = _keys.Hash( key );
+            if ( _bloom->MayContain( hash ) ) return _keys.Insert( key, hash );
+            _bloom->Add( hash );
+            _keys.InsertNew( key, hash );
+            return true;
+         }
+      private:
+         Containers::HashSet<_Key> _keys;
+         std::unique_ptr<Containers::BloomFilter> _bloom;
+      };
+   public:
+      using _IterType = LazyDistinct;
+      using _SourceIterType = typename _SourceAccess<_Iter>::_SourceIter;
+      //! Whether an element is kept depends on all elements before it, so this can't be split into chunks
+      using _Splittable = std::false_type;
+      using _SizeKnown = std::false_type;
+      using _Vectorizable = std::false_type;
+
+      LazyDistinct( _Iter begin, _Iter end, _Iter cur, const _KeyFn& keyFn, const BloomPrefilter& prefilter ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( cur ),
+         _state( _State{ keyFn, prefilter } )
+      {
+      }
+
+      LazyDistinct& operator++( )
+      {
+         if ( _cur == _end ) return *this;
+         do
+         {
+            ++_cur;
+         }
+         while ( _cur != _end &&
+                  !_seen->Insert( _state->keyFn( *_cur ) ) );
+         return *this;
+      }
+
+      //! \brief Returns the current element of the nested iterator as it is
+      _IterReference<_Iter> operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( _cur == _end ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return *_cur;
+      }
+
+      bool operator==( const LazyDistinct& other ) const
+      {
+         return _cur == other._cur;
+      }
+
+      bool operator!=( const LazyDistinct& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         return _cur == _end;
+      }
+
+      //! \brief Starts with an empty set of keys and moves to the first element
+      LazyDistinct begin() const
+      {
+         LazyDistinct begin( _begin, _end, _SourceAccess<_Iter>::First( _begin ), _state );
+         begin._seen = std::make_shared<_Seen>( _state->prefilter );
+         if ( begin._cur != _end ) begin._seen->Insert( _state->keyFn( *begin._cur ) );
+         return begin;
+      }
+
+      LazyDistinct end() const
+      {
+         return LazyDistinct( _begin, _end, _end, _state );
+      }
+
+      //! \brief Returns the begin of this range without evaluating any element
+      LazyDistinct UnevaluatedBegin() const
+      {
+         return LazyDistinct( _begin, _end, _begin, _state );
+      }
+
+      //! \brief Upper bound on the number of elements in this range
+      size_t SizeHint() const
+      {
+         return _SourceAccess<_Iter>::SizeHint( _begin, _end );
+      }
+
+      //! \brief Pushes the first element of each key into the sink
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         const auto& keyFn = _state->keyFn;
+         _Seen seen( _state->prefilter );
+         auto distinct = [&keyFn, &seen, &sink] ( auto&& val )
+         {
+            return !seen.Insert( keyFn( val ) ) || sink( std::forward<decltype( val )>( val ) );
+         };
+         return _SourceAccess<_Iter>::Push( _begin, _end, distinct );
+      }
+
+#ifdef LAZY_INSTRUMENTATION
+      //! \brief Appends the reports of the nested operations
+      void CollectReports( std::vector<StageReport>& reports ) const
+      {
+         _CollectReports( _begin, reports, 0 );
+      }
+#endif
+   private:
+      //! \brief Key function and prefilter option, which all iterators of the range share instead of copying them
+      struct _State
+      {
+         _KeyFn keyFn;
+         BloomPrefilter prefilter;
+      };
+
+      LazyDistinct( _Iter begin, _Iter end, _Iter cur, const _Shared<_State>& state ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( cur ),
+         _state( state )
+      {
+      }
+
+      _Iter _begin;
+      _Iter _end;
+      _Iter _cur;
+      _Shared<_State> _state;
+      std::shared_ptr<_Seen> _seen;
+   };
+
+   //! \brief Creates the operation for Limit( limit ) on a range whose outermost operation is of type _Iter
+   //!
+   //! This is a LazyLimit in general. Operations that can do better with a limit, e.g. LazyOrderBy, specialize
+   //! this to absorb the limit instead
+   template<typename _ValType, typename _Iter>
+   struct _LimitStage
+   {
+      using _Type = LazyLimit<_ValType, _Iter>;
+
+      static _Type Make( const _Iter& begin, const _Iter& end, size_t limit )
+      {
+         return _Type( begin, end, begin, 0, limit );
+      }
+   };
+
+   //! \brief A limited LazyOrderBy only keeps the smallest elements in a bounded heap
+   template<typename _ValType, typename _Iter, typename _KeyFn, typename _Compare>
+   struct _LimitStage<_ValType, LazyOrderBy<_ValType, _Iter, _KeyFn, _Compare>>
+   {
+      using _Type = LazyOrderBy<_ValType, _Iter, _KeyFn, _Compare>;
+
+      static _Type Make( const _Type& begin, const _Type&, size_t limit )
+      {
+         return begin.Limited( limit );
+      }
+   };
+
+   //! \brief Creates the operation for Map( fn ) on a range whose outermost operation is of type _Iter
+   //!
+   //! This is a LazyMap in general. Like _LimitStage, it is specialized to rewrite a chain of operations into
+   //! an equivalent one with fewer iterator layers, see below
+   template<typename _ValType, typename _Dst, typename _Iter, typename _Fn>
+   struct _MapStage
+   {
+      using _Type = LazyMap<_ValType, _Dst, _Iter, _Fn>;
+
+      static _Type Make( const _Iter& begin, const _Iter& end, const _Fn& fn )
+      {
+         return _Type( begin, end, begin, fn );
+      }
+   };
+
+   //! \brief Creates the operation for Filter( pred ) on a range whose outermost operation is of type _Iter
+   template<typename _ValType, typename _Iter, typename _Fn>
+   struct _FilterStage
+   {
+      using _Type = LazyFilter<_ValType, _Iter, _Fn>;
+
+      static _Type Make( const _Iter& begin, const _Iter& end, const _Fn& pred )
+      {
+         return _Type( begin, end, begin, pred );
+      }
+   };
+
+   //Rewrites of adjacent operations. Each layer of a chain calls through to the layer below it and checks for
+   //its end, so long chains, e.g. generated ones, pay for every layer. Adjacent maps are
+   //fused into one map, adjacent filters are merged into one filter, and a limit after a map is moved below the
+   //map. With LAZY_INSTRUMENTATION, the chain is kept as it was written, so that each operation reports its
+   //own statistics
+
+#ifndef LAZY_INSTRUMENTATION
+
+   //! \brief A map after a map is fused into a single map
+   template<typename _ValType, typename _Dst, typename _Src, typename _Iter, typename _InnerFn, typename _Fn>
+   struct _MapStage<_ValType, _Dst, LazyMap<_Src, _ValType, _Iter, _InnerFn>, _Fn>
+   {
+      using _Inner = LazyMap<_Src, _ValType, _Iter, _InnerFn>;
+      using _Type = LazyMap<_Src, _Dst, _Iter, _ComposedMap<_Src, _ValType, _InnerFn, _Fn>>;
+
+      static _Type Make( const _Inner& begin, const _Inner&, const _Fn& fn )
+      {
+         return begin.template Fused<_Dst>( fn );
+      }
+   };
+
+   //! \brief A filter after a filter is merged into a single filter
+   template<typename _ValType, typename _Iter, typename _InnerFn, typename _Fn>
+   struct _FilterStage<_ValType, LazyFilter<_ValType, _Iter, _InnerFn>, _Fn>
+   {
+      using _Inner = LazyFilter<_ValType, _Iter, _InnerFn>;
+      using _Type = LazyFilter<_ValType, _Iter, _ConjoinedPred<_ValType, _InnerFn, _Fn>>;
+
+      static _Type Make( const _Inner& begin, const _Inner&, const _Fn& pred )
+      {
+         return begin.Merged( pred );
+      }
+   };
+
+   //! \brief A limit after a pipelined range is moved into the pipelined thread
+   template<typename _ValType, typename _Iter>
+   struct _LimitStage<_ValType, LazyPipelined<_ValType, _Iter>>
+   {
+      using _Inner = LazyPipelined<_ValType, _Iter>;
+      using _Type = LazyPipelined<_ValType, typename _LimitStage<_ValType, _Iter>::_Type>;
+
+      static _Type Make( const _Inner& begin, const _Inner&, size_t limit )
+      {
+         return begin.Limited( limit );
+      }
+   };
+
+   //! \brief A limit after a map is moved below the map, where it may be absorbed by the nested operation
+   template<typename _ValType, typename _Src, typename _Iter, typename _Fn>
+   struct _LimitStage<_ValType, LazyMap<_Src, _ValType, _Iter, _Fn>>
+   {
+      using _Inner = LazyMap<_Src, _ValType, _Iter, _Fn>;
+      using _Type = LazyMap<_Src, _ValType, typename _LimitStage<_Src, _Iter>::_Type, _Fn>;
+
+      static _Type Make( const _Inner& begin, const _Inner&, size_t limit )
+      {
+         return begin.Limited( limit );
+      }
+   };
+
+#endif
+
+#pragma endregion
+
+#pragma region LazyRanges
+
+   //! \brief Iterator over a container that is owned by the lazy range
+   //!
+   //! Lazy operations only store the iterators of their source, so each iterator shares the ownership of the
+   //! container. This keeps the container alive as long as any operation or iterator over it exists
+   //! \tparam _Cont The container type
+   template<typename _Cont,
+            typename _Iter = typename _Cont::const_iterator>
+   class _OwningIterator : public std::iterator<typename std::iterator_traits<_Iter>::iterator_category,
+                                                typename std::iterator_traits<_Iter>::value_type,
+                                                typename std::iterator_traits<_Iter>::difference_type,
+                                                typename std::iterator_traits<_Iter>::pointer,
+                                                _IterReference<_Iter>>
+   {
+   public:
+      using _Difference = typename std::iterator_traits<_Iter>::difference_type;
+
+      _OwningIterator( const std::shared_ptr<const _Cont>& cont, _Iter cur ) :
+         _cont( cont ),
+         _cur( cur )
+      {
+      }
+
+      _IterReference<_Iter> operator*( ) const
+      {
+         return *_cur;
+      }
+
+      _OwningIterator& operator++( )
+      {
+         ++_cur;
+         return *this;
+      }
+
+      bool operator==( const _OwningIterator& other ) const
+      {
+         return _cur == other._cur;
+      }
+
+      bool operator!=( const _OwningIterator& other ) const
+      {
+         return _cur != other._cur;
+      }
+
+      //Random access operations, these are only available if the container is random access
+
+      _OwningIterator& operator--( )
+      {
+         --_cur;
+         return *this;
+      }
+
+      _OwningIterator operator+( _Difference offset ) const
+      {
+         return _OwningIterator( _cont, _cur + offset );
+      }
+
+      _OwningIterator operator-( _Difference offset ) const
+      {
+         return _OwningIterator( _cont, _cur - offset );
+      }
+
+      _Difference operator-( const _OwningIterator& other ) const
+      {
+         return _cur - other._cur;
+      }
+
+      _OwningIterator& operator+=( _Difference offset )
+      {
+         _cur += offset;
+         return *this;
+      }
+
+      _OwningIterator& operator-=( _Difference offset )
+      {
+         _cur -= offset;
+         return *this;
+      }
+
+      _IterReference<_Iter> operator[]( _Difference offset ) const
+      {
+         return _cur[offset];
+      }
+
+      bool operator<( const _OwningIterator& other ) const
+      {
+         return _cur < other._cur;
+      }
+   private:
+      std::shared_ptr<const _Cont> _cont;
+      _Iter _cur;
+   };
+
+   //! \brief Range for a common container
+   template<typename _Cont, typename _ValType = typename _Cont::value_type, typename _Iter = typename _Cont::const_iterator>
+   class ContainerRange : public std::iterator<_StageCategory<_Iter>, _ValType>
+   {
+   public:
+      using _IterType = _Iter;
+      using _SourceIterType = _Iter;
+      using _Splittable = typename _SourceAccess<_Iter>::_Splittable;
+      using _SizeKnown = typename _SourceAccess<_Iter>::_SizeKnown;
+      using _Vectorizable = typename _SourceAccess<_Iter>::_Vectorizable;
+
+      ContainerRange( const _Cont& cont ) :
+         _begin( std::begin( cont ) ),
+         _end( std::end( cont ) ),
+         _cur( std::begin( cont ) )
+      {
+      }
+
+      ContainerRange( _Iter begin, _Iter end ) :
+         _begin( begin ),
+         _end( end ),
+         _cur( begin )
+      {
+      }
+
+      ContainerRange( const ContainerRange& other ) = default;
+      ContainerRange& operator=( const ContainerRange& other ) = default;
+
+      ContainerRange& operator++( )
+      {
+         if ( _cur != _end ) ++_cur;
+         return *this;
+      }
+
+      const _ValType& operator*( ) const
+      {
+         if constexpr ( CheckedIteration )
+         {
+            if ( _cur == _end ) throw std::runtime_error( "Dereferencing end iterator!" );
+         }
+         return *_cur;
+      }
+
+      bool operator==( const ContainerRange& other ) const
+      {
+         return _begin == other._begin && _end == other._end && _cur == other._cur;
+      }
+
+      bool operator!=( const ContainerRange& other ) const
+      {
+         return operator==( other );
+      }
+
+      _Iter begin() const
+      {
+         return _begin;
+      }
+
+      _Iter end() const
+      {
+         return _end;
+      }
+
+      _Iter UnevaluatedBegin() const
+      {
+         return _begin;
+      }
+
+      bool IsAtEnd() const
+      {
+         return _cur == _end;
+      }
+
+      _Iter SourceBegin() const
+      {
+         return _begin;
+      }
+
+      _Iter SourceEnd() const
+      {
+         return _end;
+      }
+
+      //! \brief Returns a range over the given subrange of the container
+      ContainerRange Rebase( _Iter first, _Iter last ) const
+      {
+         return ContainerRange( first, last );
+      }
+
+      //! \brief Number of elements in this range, in constant time if the container is random access
+      size_t SizeHint() const
+      {
+         return _SourceAccess<_Iter>::SizeHint( _begin, _end );
+      }
+
+      //! \brief Copies a block of source elements
+      size_t EvalBlock( const _ValType* src, size_t count, _ValType* out ) const
+      {
+         std::copy( src, src + count, out );
+         return count;
+      }
+
+      //! \brief Pushes all elements of this range into the sink
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         return _SourceAccess<_Iter>::Push( _begin, _end, sink );
+      }
+   private:
+      _Iter _begin;
+      _Iter _end;
+      _Iter _cur;
+   };
+
+   //! \brief Execution policy for terminal operations that evaluates a range in parallel
+   //!
+   //! Ranges over a random access source are split into chunks, which are evaluated on a thread pool. All
+   //! other ranges are evaluated sequentially
+   struct Parallel
+   {
+      //! \param minChunkSize Minimum number of source elements per chunk
+      //! \param pool The thread pool to use, the shared thread pool if this is null
+      explicit Parallel( size_t minChunkSize = 4096, Threading::ThreadPool* pool = nullptr ) :
+         minChunkSize( minChunkSize ),
+         pool( pool )
+      {
+      }
+
+      Threading::ThreadPool& Pool() const
+      {
+         return pool ? *pool : Threading::ThreadPool::Shared();
+      }
+
+      //! \brief Number of chunks for a source with the given number of elements
+      size_t ChunkCount( size_t elementCount ) const
+      {
+         //A few chunks per thread so that chunks with expensive elements don't stall the others
+         size_t maxChunks = ( Pool().ThreadCount() + 1 ) * 4;
+         size_t chunks = elementCount / std::max( minChunkSize, size_t( 1 ) );
+         return std::max( std::min( chunks, maxChunks ), size_t( 1 ) );
+      }
+
+      size_t minChunkSize;
+      Threading::ThreadPool* pool;
+   };
+
+   //! \brief Whether a range is a filter directly over a random access source, whose elements can be selected
+   //!        by their position in the source
+   template<typename _Range>
+   struct _IsSourceFilter : std::false_type
+   {
+   };
+
+   template<typename _ValType, typename _Iter, typename _Fn>
+   struct _IsSourceFilter<LazyFilter<_ValType, _Iter, _Fn>> :
+      std::integral_constant<bool, std::is_same<typename _SourceAccess<_Iter>::_SourceIter, _Iter>::value &&
+                                   _SourceAccess<_Iter>::_Splittable::value>
+   {
+   };
+
+   template<typename _ValType,
+            typename _Range,
+            typename _Iter = typename _Range::_IterType>
+   class LazyRange : public std::iterator<std::forward_iterator_tag, _ValType>
+   {
+      template<typename, typename, typename> friend class LazyRange;
+      template<typename, typename> friend class Pipeline;
+   public:
+      using _ThisType = LazyRange;
+
+      LazyRange( _Range range ) :
+         _range( range )
+      {
+      }
+
+      LazyRange( const _ThisType& other ) :
+         _range( other._range )
+      {
+      }
+
+      _ThisType& operator=( const _ThisType& other )
+      {
+         _range = other._range;
+      }
+
+      _ThisType& operator++( )
+      {
+         ++_range;
+         return *this;
+      }
+
+      _IterReference<_Range> operator*( ) const
+      {
+         return *_range;
+      }
+
+      bool operator==( const _ThisType& other ) const
+      {
+         return _range == other._range;
+      }
+
+      bool operator!=( const _ThisType& other ) const
+      {
+         return !operator==( other );
+      }
+
+      _Iter begin( ) const
+      {
+         return std::begin( _range ); 
+      }
+      
+      _Iter end( ) const
+      {
+         return std::end( _range );
+      }
+
+      //! \brief Pushes all elements of this range into the sink
+      //! \param sink Called with each element, returns false if it does not accept more elements
+      //! \returns False if the sink stopped the evaluation
+      template<typename _Sink>
+      bool Push( _Sink& sink ) const
+      {
+         return _range.Push( sink );
+      }
+
+      //The transformation methods
+
+      //! \brief Apply a map operation to this range
+      //! \param map The map function
+      //! \returns A LazyRange with the mapping operation applied
+      //! \tparam _Dst The destination type of the map operation
+      template<typename _Dst>
+      LazyRange<_Dst, typename _MapStage<_ValType, _Dst, _Iter, _Map<_ValType, _Dst>>::_Type> Map( const _Map<_ValType, _Dst>& map ) const
+      {
+         using _MapType = _MapStage<_ValType, _Dst, _Iter, _Map<_ValType, _Dst>>;
+         using _Ret = LazyRange<_Dst, typename _MapType::_Type>;
+
+         auto iter = _MapType::Make( _range.UnevaluatedBegin(), std::end( _range ), map );
+         return _Ret( iter );
+      }
+
+      //! \brief Apply a map operation to this range
+      //! \param map The map function
+      //! \returns A LazyRange with the mapping operation applied
+      LazyRange<_ValType, typename _MapStage<_ValType, _ValType, _Iter, _Map<_ValType, _ValType>>::_Type> Map( const _Map<_ValType, _ValType>& map ) const
+      {
+         using _MapType = _MapStage<_ValType, _ValType, _Iter, _Map<_ValType, _ValType>>;
+         using _Ret = LazyRange<_ValType, typename _MapType::_Type>;
+
+         auto iter = _MapType::Make( _range.UnevaluatedBegin(), std::end( _range ), map );
+         return _Ret( iter );
+      }
+
+      //! \brief Apply a map operation to this range
+      //!
+      //! In contrast to the std::function overloads, this keeps the concrete type of the map function, so
+      //! that a chain of lazy operations can be inlined into a single loop. A map directly after a map is fused
+      //! with it into a single operation
+      //! \param map The map function
+      //! \returns A LazyRange with the mapping operation applied
+      //! \tparam _Fn Type of the map function
+      //! \tparam _Dst The destination type of the map operation, deduced from the map function
+      template<typename _Fn,
+               typename _Dst = _MapResult<_Fn, _ValType>>
+      LazyRange<_Dst, typename _MapStage<_ValType, _Dst, _Iter, _Fn>::_Type> Map( _Fn map ) const
+      {
+         using _MapType = _MapStage<_ValType, _Dst, _Iter, _Fn>;
+         using _Ret = LazyRange<_Dst, typename _MapType::_Type>;
+
+         auto iter = _MapType::Make( _range.UnevaluatedBegin(), std::end( _range ), map );
+         return _Ret( iter );
+      }
+
+      //! \brief Apply a filter operation to this range
+      //! \param pred Predicate for the filter operation
+      //! \returns A LazyRange with the filter operation applied
+      LazyRange<_ValType, typename _FilterStage<_ValType, _Iter, _Pred<_ValType>>::_Type> Filter( const _Pred<_ValType>& pred ) const
+      {
+         using _FilterType = _FilterStage<_ValType, _Iter, _Pred<_ValType>>;
+         using _Ret = LazyRange<_ValType, typename _FilterType::_Type>;
+
+         auto iter = _FilterType::Make( _range.UnevaluatedBegin(), std::end( _range ), pred );
+         return _Ret( iter );
+      }
+
+      //! \brief Apply a filter operation to this range
+      //!
+      //! In contrast to the std::function overload, this keeps the concrete type of the predicate, so
+      //! that a chain of lazy operations can be inlined into a single loop. A filter directly after a filter
+      //! is merged with it into a single operation
       //! \param pred Predicate for the filter operation
       //! \returns A LazyRange with the filter operation applied
-      LazyRange<_ValType, LazyFilter<_ValType, _Iter>> Filter( const _Pred<_ValType>& pred ) const
+      //! \tparam _Fn Type of the predicate
+      template<typename _Fn>
+      LazyRange<_ValType, typename _FilterStage<_ValType, _Iter, _Fn>::_Type> Filter( _Fn pred ) const
+      {
+         using _FilterType = _FilterStage<_ValType, _Iter, _Fn>;
+         using _Ret = LazyRange<_ValType, typename _FilterType::_Type>;
+
+         auto iter = _FilterType::Make( _range.UnevaluatedBegin(), std::end( _range ), pred );
+         return _Ret( iter );
+      }
+
+      //! \brief Returns the first element in this range if it exists
+      //! \returns Optional that contains the first element in this range if it exists
+      Optional<_ValType> First() const
+      {
+         auto ret = Optional<_ValType>::False();
+         auto first = [&ret] ( auto&& val )
+         {
+            ret = Optional<_ValType>::True( std::forward<decltype( val )>( val ) );
+            return false;
+         };
+         _range.Push( first );
+         return ret;
+      }
+
+      //! \brief Apply a limit to this range
+      //!
+      //! A limit, as the name suggests, limits the maximum number of elements in a range to 
+      //! a specific number. The actual number of elements in the range may be lower than the
+      //! limit however.
+      //!
+      //! A limit directly after OrderBy keeps only the first elements in a bounded heap instead of sorting
+      //! all elements. A limit after a map is moved below the map, so this also applies to OrderBy followed
+      //! by maps
+      //! \param limit The maximum number of elements 
+      //! \returns A LazyRange with the limit applied
+      LazyRange<_ValType, typename _LimitStage<_ValType, _Iter>::_Type> Limit( size_t limit ) const
+      {
+         using _LimitType = typename _LimitStage<_ValType, _Iter>::_Type;
+         using _Ret = LazyRange<_ValType, _LimitType>;
+         
+         auto iter = _LimitStage<_ValType, _Iter>::Make( _range.UnevaluatedBegin(), std::end( _range ), limit );
+         return _Ret( iter );
+      }
+
+      //! \brief Sort the elements of this range by a key, in ascending order
+      //!
+      //! The elements are evaluated and sorted once iteration starts. Followed by Limit( k ), only the k
+      //! elements with the smallest keys are kept in a bounded heap
+      //! \param keyFn Returns the key of an element, the keys are compared with operator<
+      //! \returns A LazyRange with the elements of this range in ascending order of their keys
+      template<typename _KeyFn>
+      LazyRange<_ValType, LazyOrderBy<_ValType, _Iter, _KeyFn, std::less<>>> OrderBy( _KeyFn keyFn ) const
+      {
+         using _OrderByType = LazyOrderBy<_ValType, _Iter, _KeyFn, std::less<>>;
+         using _Ret = LazyRange<_ValType, _OrderByType>;
+
+         auto iter = _OrderByType( _range.UnevaluatedBegin(), std::end( _range ), keyFn );
+         return _Ret( iter );
+      }
+
+      //! \brief Sort the elements of this range by a key, in descending order
+      //! \param keyFn Returns the key of an element, the keys are compared with operator>
+      //! \returns A LazyRange with the elements of this range in descending order of their keys
+      template<typename _KeyFn>
+      LazyRange<_ValType, LazyOrderBy<_ValType, _Iter, _KeyFn, std::greater<>>> OrderByDescending( _KeyFn keyFn ) const
+      {
+         using _OrderByType = LazyOrderBy<_ValType, _Iter, _KeyFn, std::greater<>>;
+         using _Ret = LazyRange<_ValType, _OrderByType>;
+
+         auto iter = _OrderByType( _range.UnevaluatedBegin(), std::end( _range ), keyFn );
+         return _Ret( iter );
+      }
+
+      //! \brief Remove duplicate elements from this range
+      //!
+      //! Only the first occurrence of each element is kept, in the order of this range. The elements that were
+      //! seen are kept in a hash set, so they have to be hashable with std::hash and comparable with operator==
+      //! \returns A LazyRange without duplicates
+      LazyRange<_ValType, LazyDistinct<_ValType, _Iter, _Identity>> Distinct() const
+      {
+         return DistinctBy( _Identity() );
+      }
+
+      //! \brief Remove duplicate elements from this range, with a Bloom filter in front of the set of seen elements
+      //! \param prefilter Size of the Bloom filter
+      //! \returns A LazyRange without duplicates
+      LazyRange<_ValType, LazyDistinct<_ValType, _Iter, _Identity>> Distinct( const BloomPrefilter& prefilter ) const
+      {
+         return DistinctBy( _Identity(), prefilter );
+      }
+
+      //! \brief Remove elements whose key equals the key of an earlier element
+      //! \param keyFn Returns the key of an element, the keys have to be hashable with std::hash and
+      //!              comparable with operator==
+      //! \returns A LazyRange with only the first element of each key
+      template<typename _KeyFn>
+      LazyRange<_ValType, LazyDistinct<_ValType, _Iter, _KeyFn>> DistinctBy( _KeyFn keyFn ) const
+      {
+         return DistinctBy( keyFn, BloomPrefilter( 0 ) );
+      }
+
+      //! \brief Remove elements whose key equals the key of an earlier element, with a Bloom filter in front of
+      //!        the set of seen keys
+      //! \param keyFn Returns the key of an element
+      //! \param prefilter Size of the Bloom filter
+      //! \returns A LazyRange with only the first element of each key
+      template<typename _KeyFn>
+      LazyRange<_ValType, LazyDistinct<_ValType, _Iter, _KeyFn>> DistinctBy( _KeyFn keyFn, const BloomPrefilter& prefilter ) const
+      {
+         using _DistinctType = LazyDistinct<_ValType, _Iter, _KeyFn>;
+         using _Ret = LazyRange<_ValType, _DistinctType>;
+
+         auto iter = _DistinctType( _range.UnevaluatedBegin(), std::end( _range ), _range.UnevaluatedBegin(), keyFn, prefilter );
+         return _Ret( iter );
+      }
+
+      //! \brief Evaluate this range on a thread of its own
+      //!
+      //! The elements are passed on in order through a bounded queue, while the thread already evaluates the
+      //! next ones. Placing this after each expensive map, e.g. Map( decode ).Pipelined().Map( transform ),
+      //! runs each map on its own thread, which also works for sources that can't be split into chunks
+      //! \param capacity Number of elements the thread may evaluate ahead of the consumer
+      //! \returns A LazyRange that is evaluated on another thread
+      LazyRange<_ValType, LazyPipelined<_ValType, _Iter>> Pipelined( size_t capacity = 1024 ) const
+      {
+         using _PipelinedType = LazyPipelined<_ValType, _Iter>;
+         using _Ret = LazyRange<_ValType, _PipelinedType>;
+
+         auto iter = _PipelinedType( _range.UnevaluatedBegin(), std::end( _range ), capacity );
+         return _Ret( iter );
+      }
+
+      //! \brief Apply a flat map operation to this range
+      //!
+      //! Each element is mapped to a range, e.g. a container or a LazyRange, and the resulting range contains
+      //! the elements of all these ranges. The function can return a reference to a container, e.g. a member
+      //! of the element, which is then iterated without copying it
+      //! \param fn Maps an element to a range
+      //! \returns A LazyRange with the flat map operation applied
+      //! \tparam _Fn Type of the function
+      //! \tparam _Dst Value type of the ranges returned by the function, deduced from the function
+      template<typename _Fn,
+               typename _Dst = _RangeValue<_FlatMapRange<_Fn, _ValType>>>
+      LazyRange<_Dst, LazyFlatMap<_ValType, _Dst, _Iter, _Fn>> FlatMap( _Fn fn ) const
+      {
+         using _FlatMapType = LazyFlatMap<_ValType, _Dst, _Iter, _Fn>;
+         using _Ret = LazyRange<_Dst, _FlatMapType>;
+
+         auto iter = _FlatMapType( _range.UnevaluatedBegin(), std::end( _range ), _range.UnevaluatedBegin(), fn );
+         return _Ret( iter );
+      }
+
+      //! \brief Append the elements of another range to this range
+      //! \param other The range whose elements follow the elements of this range
+      //! \returns A LazyRange with the elements of this range followed by the elements of the other range
+      template<typename _OtherRange, typename _OtherIter>
+      LazyRange<_ValType, LazyConcat<_ValType, _Iter, _OtherIter>> Concat( const LazyRange<_ValType, _OtherRange, _OtherIter>& other ) const
+      {
+         using _ConcatType = LazyConcat<_ValType, _Iter, _OtherIter>;
+         using _Ret = LazyRange<_ValType, _ConcatType>;
+
+         auto iter = _ConcatType( _range.UnevaluatedBegin(), std::end( _range ),
+                                  other._range.UnevaluatedBegin(), std::end( other._range ) );
+         return _Ret( iter );
+      }
+
+      //! \brief Group consecutive elements of this range into chunks
+      //!
+      //! Each chunk is a BufferView, which is only valid until the next chunk is evaluated. The last chunk
+      //! contains the remaining elements and may be smaller than the others
+      //! \param size The number of elements per chunk
+      //! \returns A LazyRange of the chunks of this range
+      LazyRange<BufferView<_ValType>, LazyChunk<_ValType, _Iter>> Chunk( size_t size ) const
+      {
+         using _ChunkType = LazyChunk<_ValType, _Iter>;
+         using _Ret = LazyRange<BufferView<_ValType>, _ChunkType>;
+
+         if ( size == 0 ) throw std::runtime_error( "Chunk size must not be zero!" );
+         auto iter = _ChunkType( _range.UnevaluatedBegin(), std::end( _range ), _range.UnevaluatedBegin(), size );
+         return _Ret( iter );
+      }
+
+      //! \brief Slide a window over the elements of this range
+      //!
+      //! The window moves by one element at a time. Each window is a BufferView over a ring buffer, which is
+      //! only valid until the next window is evaluated. Ranges with less elements than the window size have
+      //! no windows
+      //! \param size The number of elements per window
+      //! \returns A LazyRange of the windows of this range
+      LazyRange<BufferView<_ValType>, LazyWindow<_ValType, _Iter>> Window( size_t size ) const
+      {
+         using _WindowType = LazyWindow<_ValType, _Iter>;
+         using _Ret = LazyRange<BufferView<_ValType>, _WindowType>;
+
+         if ( size == 0 ) throw std::runtime_error( "Window size must not be zero!" );
+         auto iter = _WindowType( _range.UnevaluatedBegin(), std::end( _range ), _range.UnevaluatedBegin(), size );
+         return _Ret( iter );
+      }
+
+#ifdef LAZY_INSTRUMENTATION
+      //! \brief Returns the statistics of the filter, map and limit operations of this range
+      //!
+      //! The statistics add up over all evaluations of this range and of the ranges that are created from it,
+      //! because they share the operations. The chain of reports ends at the first operation from the end that
+      //! is not instrumented, e.g. a cache
+      PipelineReport Report() const
+      {
+         PipelineReport report;
+         _CollectReports( _range, report.stages, 0 );
+         return report;
+      }
+#endif
+
+      //Size queries
+
+      //! \brief Returns an upper bound on the number of elements in this range without evaluating it
+      //!
+      //! This is the exact number of elements if the range contains no filter. The bound is computed
+      //! in constant time if the source is random access, otherwise the source is traversed once
+      size_t SizeHint() const
+      {
+         return _range.SizeHint();
+      }
+
+      //! \brief Returns the number of elements in this range without evaluating it
+      //!
+      //! Only available if the size is known exactly and in constant time, i.e. for ranges over a random
+      //! access source that contain no filter
+      size_t Size() const
+      {
+         static_assert( _Range::_SizeKnown::value, "The size of this range is not known without evaluating it!" );
+         return _range.SizeHint();
+      }
+
+      //! \brief Memoize the elements of this range
+      //!
+      //! Each element is evaluated at most once, no matter how often the resulting range and its copies are
+      //! iterated. Use this for ranges with expensive operations that are iterated multiple times
+      //! \returns A LazyRange that caches the elements of this range
+      LazyRange<_ValType, LazyCache<_ValType, _Iter>> Cache() const
+      {
+         using _CacheType = LazyCache<_ValType, _Iter>;
+         using _Ret = LazyRange<_ValType, _CacheType>;
+
+         auto iter = _CacheType( _range.UnevaluatedBegin(), std::end( _range ) );
+         return _Ret( iter );
+      }
+
+      //Container conversion methods
+
+      //! \brief Converts this range to a vector, thus evaluating all elements in the range
+      //! \returns The elements of this range after evaluation, stored in a vector
+      std::vector<_ValType> ToVector() const
+      {
+         static_assert( _Collectable::value, "ToVector copies the elements that the range refers to, e.g. those of its source "
+                                             "container, so move-only elements have to be mapped to new values first" );
+         std::vector<_ValType> ret;
+         if ( _Range::_SizeKnown::value ) ret.reserve( _range.SizeHint() );
+         //Temporaries, e.g. the results of a map, are moved into the vector
+         auto append = [&ret] ( auto&& val )
+         {
+            ret.push_back( std::forward<decltype( val )>( val ) );
+            return true;
+         };
+         _range.Push( append );
+         return std::move( ret );
+      }
+
+      //! \brief Converts this range to a vector, evaluating the elements in parallel
+      //!
+      //! Each chunk of the source is evaluated into its own buffer. The buffers are then moved into the
+      //! result at the offsets given by the prefix sum of their sizes, so the order of the elements is the
+      //! same as with the sequential ToVector. A filter directly over a random access source is instead
+      //! evaluated into a bitmask, from which the selected elements are copied straight into the result. Pools
+      //! without worker threads and sources that fit into a single chunk use the sequential ToVector instead
+      //! \param policy The parallel execution policy
+      //! \returns The elements of this range after evaluation, stored in a vector
+      std::vector<_ValType> ToVector( const Parallel& policy ) const
+      {
+         static_assert( _Collectable::value, "ToVector copies the elements that the range refers to, e.g. those of its source "
+                                             "container, so move-only elements have to be mapped to new values first" );
+         //Without worker threads or with a single chunk, the buffers or the mask only add work to the sequential pass
+         if ( policy.Pool().ThreadCount() == 0 || ChunkCount( policy, typename _Range::_Splittable() ) == 1 ) return ToVector();
+         //The bitmask path assigns the selected elements to a result of the final size
+         using _Bitmask = std::integral_constant<bool, _IsSourceFilter<_Range>::value &&
+                                                       std::is_default_constructible<_ValType>::value &&
+                                                       std::is_copy_assignable<_ValType>::value>;
+         return ToVectorParallel( policy, _Bitmask() );
+      }
+
+      //! \brief Converts this range to a vector, evaluating the elements in blocks
+      //!
+      //! Falls back to the sequential ToVector if this range does not consist of arithmetic values over a
+      //! contiguous source or contains operations that can't be evaluated in blocks, e.g. Limit
+      //! \returns The elements of this range after evaluation, stored in a vector
+      std::vector<_ValType> ToVector( const Vectorized& ) const
+      {
+         return ToVectorBlocked( typename _Range::_Vectorizable() );
+      }
+
+      //Reductions
+
+      //! \brief Combines all elements of this range into a single value
+      //! \param init Initial value of the accumulator
+      //! \param fn Called with the accumulator and each element, returns the new accumulator. The accumulator
+      //!           is passed as an rvalue, so fn can update and return it instead of copying it
+      //! \returns The final accumulator
+      template<typename _Acc, typename _Fn>
+      _Acc Fold( _Acc init, _Fn fn ) const
+      {
+         return Reduce( std::move( init ), FoldUpdate<_Fn>{ std::move( fn ) } );
+      }
+
+      //! \brief Combines all elements of this range into a single value, evaluating the elements in parallel
+      //!
+      //! Each chunk is folded separately, starting with init. The results of the chunks are then combined
+      //! pairwise in a tree, so fn has to be associative, accept two accumulators and init has to be its
+      //! identity element
+      //! \param init Initial value of the accumulator, identity element of fn
+      //! \param fn Called with the accumulator and each element, returns the new accumulator
+      //! \param policy The parallel execution policy
+      //! \returns The final accumulator
+      template<typename _Acc, typename _Fn>
+      _Acc Fold( _Acc init, _Fn fn, const Parallel& policy ) const
+      {
+         return ParallelFold( init, fn, fn, policy );
+      }
+
+      //! \brief Returns the sum of all elements in this range, or a value-initialized element for empty ranges
+      _ValType Sum() const
+      {
+         return Fold( _ValType(), [] ( const _ValType& acc, const _ValType& val ) { return acc + val; } );
+      }
+
+      //! \brief Returns the sum of all elements in this range, evaluating the elements in parallel
+      _ValType Sum( const Parallel& policy ) const
+      {
+         return Fold( _ValType(), [] ( const _ValType& acc, const _ValType& val ) { return acc + val; }, policy );
+      }
+
+      //! \brief Returns the number of elements in this range
+      //!
+      //! If the size of this range is known, no element is evaluated
+      size_t Count() const
+      {
+         if ( _Range::_SizeKnown::value ) return _range.SizeHint();
+         return Fold( size_t( 0 ), [] ( size_t count, const _ValType& ) { return count + 1; } );
+      }
+
+      //! \brief Returns the number of elements in this range, evaluating the elements in parallel
+      size_t Count( const Parallel& policy ) const
+      {
+         if ( _Range::_SizeKnown::value ) return _range.SizeHint();
+         return ParallelFold( size_t( 0 ),
+                              [] ( size_t count, const _ValType& ) { return count + 1; },
+                              [] ( size_t l, size_t r ) { return l + r; },
+                              policy );
+      }
+
+      //! \brief Returns the smallest element in this range if it exists. Of equal elements, the first is returned
+      Optional<_ValType> Min() const
       {
-         using _FilterType = LazyFilter<_ValType, _Iter>;
-         using _Ret = LazyRange<_ValType, _FilterType>;
+         return Reduce( Optional<_ValType>::False(), MinUpdate() );
+      }
 
-         auto iter = _FilterType( std::begin( _range ), std::end( _range ), std::begin( _range ), pred );
-         return _Ret( iter );
+      //! \brief Returns the smallest element in this range if it exists, evaluating the elements in parallel
+      Optional<_ValType> Min( const Parallel& policy ) const
+      {
+         return ParallelReduce( Optional<_ValType>::False(), MinUpdate(), MinCombine(), policy );
       }
 
-      //! \brief Returns the first element in this range if it exists
-      //! \returns Optional that contains the first element in this range if it exists
-      Optional<_ValType> First() const
+      //! \brief Returns the largest element in this range if it exists. Of equal elements, the first is returned
+      Optional<_ValType> Max() const
+      {
+         return Reduce( Optional<_ValType>::False(), MaxUpdate() );
+      }
+
+      //! \brief Returns the largest element in this range if it exists, evaluating the elements in parallel
+      Optional<_ValType> Max( const Parallel& policy ) const
+      {
+         return ParallelReduce( Optional<_ValType>::False(), MaxUpdate(), MaxCombine(), policy );
+      }
+
+      //! \brief Returns true if any element in this range matches the predicate
+      //!
+      //! Stops at the first matching element
+      //! \param pred The predicate
+      template<typename _Fn>
+      bool Any( _Fn pred ) const
+      {
+         bool found = false;
+         auto check = [&found, &pred] ( const _ValType& val )
+         {
+            found = pred( val );
+            return !found;
+         };
+         _range.Push( check );
+         return found;
+      }
+
+      //! \brief Returns true if all elements in this range match the predicate, which is the case for empty ranges
+      //!
+      //! Stops at the first element that does not match
+      //! \param pred The predicate
+      template<typename _Fn>
+      bool All( _Fn pred ) const
+      {
+         return !Any( [&pred] ( const _ValType& val ) { return !pred( val ); } );
+      }
+
+      //! \brief Calls the given function for each element in this range, in order
+      //! \param fn The function to call
+      template<typename _Fn>
+      void ForEach( _Fn fn ) const
+      {
+         auto call = [&fn] ( const _ValType& val )
+         {
+            fn( val );
+            return true;
+         };
+         _range.Push( call );
+      }
+
+      //! \brief Calls the given function for each element in this range, evaluating the elements in parallel
+      //!
+      //! The function is called concurrently and in no particular order if the range can be split into chunks
+      //! \param fn The function to call, has to be safe to call concurrently
+      //! \param policy The parallel execution policy
+      template<typename _Fn>
+      void ForEach( _Fn fn, const Parallel& policy ) const
+      {
+         bool split = ForEachChunk( policy, [] ( size_t ) {}, [&fn] ( size_t, const _Range& range )
+         {
+            auto call = [&fn] ( const _ValType& val )
+            {
+               fn( val );
+               return true;
+            };
+            range.Push( call );
+         } );
+         if ( !split ) ForEach( fn );
+      }
+
+      //Sketches
+
+      //! \brief Estimates the number of distinct elements in this range with a HyperLogLog sketch
+      //!
+      //! Takes a single pass and 2^precision bytes, no matter how many elements there are. The standard error is
+      //! about 1.04 / sqrt( 2^precision ), i.e. 1.6% for the default precision. Elements are hashed with std::hash
+      //! \param precision Base 2 logarithm of the number of registers of the sketch, between 4 and 18
+      size_t CountDistinctApprox( unsigned precision = 12 ) const
+      {
+         auto sketch = Sketch( Sketches::HyperLogLog( precision ), HashAdd() );
+         return static_cast<size_t>( std::llround( sketch.Estimate() ) );
+      }
+
+      //! \brief Estimates the number of distinct elements in this range, evaluating the elements in parallel
+      size_t CountDistinctApprox( const Parallel& policy ) const
+      {
+         return CountDistinctApprox( 12, policy );
+      }
+
+      //! \brief Estimates the number of distinct elements in this range, evaluating the elements in parallel
+      //!
+      //! Each chunk is added to its own sketch, the sketches are then merged in a tree. The result is the same as
+      //! that of the sequential CountDistinctApprox
+      size_t CountDistinctApprox( unsigned precision, const Parallel& policy ) const
+      {
+         auto sketch = ParallelSketch( Sketches::HyperLogLog( precision ), HashAdd(), policy );
+         return static_cast<size_t>( std::llround( sketch.Estimate() ) );
+      }
+
+      //! \brief Summarizes the elements of this range in a quantile sketch, e.g. for percentiles of latencies
+      //!
+      //! Takes a single pass and memory for about 4k elements, no matter how many elements there are, instead of
+      //! sorting all of them. The sketch answers any number of quantile queries and can be merged with the
+      //! sketches of other ranges
+      //! \param k Accuracy of the sketch, see Sketches::QuantileSketch
+      Sketches::QuantileSketch<_ValType> QuantilesApprox( size_t k = 200 ) const
+      {
+         return Sketch( Sketches::QuantileSketch<_ValType>( k ), ValueAdd() );
+      }
+
+      //! \brief Summarizes the elements of this range in a quantile sketch, evaluating the elements in parallel
+      Sketches::QuantileSketch<_ValType> QuantilesApprox( const Parallel& policy ) const
+      {
+         return QuantilesApprox( 200, policy );
+      }
+
+      //! \brief Summarizes the elements of this range in a quantile sketch, evaluating the elements in parallel
+      //!
+      //! Each chunk is added to its own sketch, the sketches are then merged in a tree. The accuracy is the same as
+      //! that of the sequential QuantilesApprox, but the retained elements differ
+      Sketches::QuantileSketch<_ValType> QuantilesApprox( size_t k, const Parallel& policy ) const
+      {
+         return ParallelSketch( Sketches::QuantileSketch<_ValType>( k ), ValueAdd(), policy );
+      }
+
+      //Grouping
+
+      //! \brief Folds the elements of each key separately
+      //!
+      //! The elements are streamed into a hash table, so this takes a single pass and memory for each distinct
+      //! key only. Keys are stored in the table, so they have to own their data, e.g. std::string instead of
+      //! std::string_view
+      //! \param keyFn Returns the key of an element
+      //! \param init Initial value of the accumulator of each key
+      //! \param fn Called with the accumulator of the key of each element and the element, returns the new accumulator
+      //! \returns Table with the final accumulator of each key, in the order in which the keys first occurred
+      template<typename _KeyFn, typename _Acc, typename _Fn,
+               typename _Key = _MapResult<_KeyFn, _ValType>>
+      Containers::HashTable<_Key, _Acc> AggregateBy( _KeyFn keyFn, _Acc init, _Fn fn ) const
+      {
+         Containers::HashTable<_Key, _Acc> table;
+         AggregateInto( _range, table, keyFn, init, FoldUpdate<_Fn>{ fn } );
+         return table;
+      }
+
+      //! \brief Folds the elements of each key separately, evaluating the elements in parallel
+      //!
+      //! Each chunk is aggregated into its own table. The tables are then merged pairwise in a tree, so as with
+      //! the parallel Fold, fn has to be associative, accept two accumulators and init has to be its identity element
+      //! \param keyFn Returns the key of an element
+      //! \param init Initial value of the accumulator of each key, identity element of fn
+      //! \param fn Called with the accumulator of the key of each element and the element, returns the new accumulator
+      //! \param policy The parallel execution policy
+      //! \returns Table with the final accumulator of each key, in the order in which the keys first occurred
+      template<typename _KeyFn, typename _Acc, typename _Fn,
+               typename _Key = _MapResult<_KeyFn, _ValType>>
+      Containers::HashTable<_Key, _Acc> AggregateBy( _KeyFn keyFn, _Acc init, _Fn fn, const Parallel& policy ) const
+      {
+         auto merge = [&fn] ( _Acc& acc, _Acc&& other ) { acc = fn( std::move( acc ), std::move( other ) ); };
+         return ParallelAggregate<_Key>( keyFn, init, FoldUpdate<_Fn>{ fn }, merge, policy );
+      }
+
+      //! \brief Groups the elements of this range by their keys
+      //! \param keyFn Returns the key of an element. Keys have to own their data, see AggregateBy
+      //! \returns Table with the elements of each key, in the order in which the keys first occurred. The elements
+      //!          of a key keep their order
+      template<typename _KeyFn,
+               typename _Key = _MapResult<_KeyFn, _ValType>>
+      Containers::HashTable<_Key, std::vector<_ValType>> GroupBy( _KeyFn keyFn ) const
+      {
+         Containers::HashTable<_Key, std::vector<_ValType>> table;
+         AggregateInto( _range, table, keyFn, std::vector<_ValType>(), AppendUpdate() );
+         return table;
+      }
+
+      //! \brief Groups the elements of this range by their keys, evaluating the elements in parallel
+      //! \param keyFn Returns the key of an element, has to be safe to call concurrently
+      //! \param policy The parallel execution policy
+      //! \returns The same table as the sequential GroupBy
+      template<typename _KeyFn,
+               typename _Key = _MapResult<_KeyFn, _ValType>>
+      Containers::HashTable<_Key, std::vector<_ValType>> GroupBy( _KeyFn keyFn, const Parallel& policy ) const
+      {
+         //Chunks are merged in order, so appending keeps the order of the elements of each key
+         auto merge = [] ( std::vector<_ValType>& group, std::vector<_ValType>&& other )
+         {
+            group.insert( group.end(), std::make_move_iterator( other.begin() ), std::make_move_iterator( other.end() ) );
+         };
+         return ParallelAggregate<_Key>( keyFn, std::vector<_ValType>(), AppendUpdate(), merge, policy );
+      }
+   private:
+      //! \brief Whether the elements can be collected into a vector. Temporaries, e.g. the results of a map, are
+      //! moved, but elements the range only refers to are copied, even if the range owns its source container,
+      //! because copies of the range share the container
+      using _Collectable = std::integral_constant<bool, !std::is_reference<_IterReference<_Iter>>::value ||
+                                                        std::is_copy_constructible<_ValType>::value>;
+
+      //! \brief Updates a single accumulator in place with all elements of this range
+      //! \param update Called with the accumulator and each element, updates the accumulator
+      template<typename _Acc, typename _UpdateFn>
+      _Acc Reduce( _Acc init, const _UpdateFn& update ) const
+      {
+         auto acc = std::move( init );
+         auto step = [&acc, &update] ( const _ValType& val )
+         {
+            update( acc, val );
+            return true;
+         };
+         _range.Push( step );
+         return acc;
+      }
+
+      //! \brief Folds each chunk separately and combines the results of the chunks in a tree
+      template<typename _Acc, typename _Fn, typename _CombineFn>
+      _Acc ParallelFold( _Acc init, _Fn fn, _CombineFn combine, const Parallel& policy ) const
+      {
+         return ParallelReduce( std::move( init ), FoldUpdate<_Fn>{ std::move( fn ) }, combine, policy );
+      }
+
+      //! \brief Updates an accumulator per chunk in place and combines the results of the chunks in a tree
+      template<typename _Acc, typename _UpdateFn, typename _CombineFn>
+      _Acc ParallelReduce( _Acc init, const _UpdateFn& update, _CombineFn combine, const Parallel& policy ) const
       {
-         for ( auto val : _range )
+         //Wrapped so that each chunk gets its own object, even for bool
+         struct _Partial
          {
-            return Optional<_ValType>::True( val );
+            _Acc acc;
+         };
+
+         std::vector<_Partial> partials;
+         bool split = ForEachChunk( policy, [&] ( size_t chunkCount ) { partials.assign( chunkCount, _Partial{ init } ); },
+                                    [&] ( size_t chunk, const _Range& range )
+         {
+            auto& acc = partials[chunk].acc;
+            auto step = [&acc, &update] ( const _ValType& val )
+            {
+               update( acc, val );
+               return true;
+            };
+            range.Push( step );
+         } );
+         if ( !split ) return Reduce( std::move( init ), update );
+
+         //Combine pairs of partial results that are stride chunks apart, until only the first remains
+         for ( size_t stride = 1; stride < partials.size(); stride *= 2 )
+         {
+            size_t pairCount = ( partials.size() + 2 * stride - 1 ) / ( 2 * stride );
+            policy.Pool().ParallelFor( pairCount, [&] ( size_t pair )
+            {
+               size_t left = pair * 2 * stride;
+               size_t right = left + stride;
+               if ( right < partials.size() ) partials[left].acc = combine( std::move( partials[left].acc ), std::move( partials[right].acc ) );
+            } );
          }
-         return Optional<_ValType>::False();
+         return std::move( partials[0].acc );
       }
 
-      //! \brief Apply a limit to this range
+      //! \brief Adds the elements of this range to a copy of the given empty sketch
+      template<typename _Sketch, typename _AddFn>
+      _Sketch Sketch( const _Sketch& empty, _AddFn add ) const
+      {
+         auto sketch = empty;
+         auto step = [&sketch, &add] ( const _ValType& val )
+         {
+            add( sketch, val );
+            return true;
+         };
+         _range.Push( step );
+         return sketch;
+      }
+
+      //! \brief Adds each chunk to its own copy of the given empty sketch and merges the sketches in a tree
+      template<typename _Sketch, typename _AddFn>
+      _Sketch ParallelSketch( const _Sketch& empty, _AddFn add, const Parallel& policy ) const
+      {
+         std::vector<_Sketch> partials;
+         bool split = ForEachChunk( policy, [&] ( size_t chunkCount ) { partials.assign( chunkCount, empty ); },
+                                    [&] ( size_t chunk, const _Range& range )
+         {
+            auto& sketch = partials[chunk];
+            auto step = [&sketch, &add] ( const _ValType& val )
+            {
+               add( sketch, val );
+               return true;
+            };
+            range.Push( step );
+         } );
+         if ( !split ) return Sketch( empty, add );
+
+         for ( size_t stride = 1; stride < partials.size(); stride *= 2 )
+         {
+            size_t pairCount = ( partials.size() + 2 * stride - 1 ) / ( 2 * stride );
+            policy.Pool().ParallelFor( pairCount, [&] ( size_t pair )
+            {
+               size_t left = pair * 2 * stride;
+               size_t right = left + stride;
+               if ( right < partials.size() ) partials[left].Merge( partials[right] );
+            } );
+         }
+         return std::move( partials[0] );
+      }
+
+      //! \brief Adds an element to a HyperLogLog sketch by its hash
+      struct HashAdd
+      {
+         void operator()( Sketches::HyperLogLog& sketch, const _ValType& val ) const
+         {
+            sketch.Add( static_cast<uint64_t>( std::hash<_ValType>()( val ) ) );
+         }
+      };
+
+      //! \brief Adds an element to a sketch of the elements themselves
+      struct ValueAdd
+      {
+         template<typename _Sketch>
+         void operator()( _Sketch& sketch, const _ValType& val ) const
+         {
+            sketch.Add( val );
+         }
+      };
+
+      //! \brief Updates an accumulator of AggregateBy in place with a fold function
+      template<typename _Fn>
+      struct FoldUpdate
+      {
+         template<typename _Acc>
+         void operator()( _Acc& acc, const _ValType& val ) const
+         {
+            acc = fn( std::move( acc ), val );
+         }
+
+         _Fn fn;
+      };
+
+      //! \brief Appends an element to its group, without copying the group as a fold function would
+      struct AppendUpdate
+      {
+         template<typename _Val>
+         void operator()( std::vector<_ValType>& group, _Val&& val ) const
+         {
+            group.push_back( std::forward<_Val>( val ) );
+         }
+      };
+
+      //! \brief Streams the elements of the given range into the table
+      //! \param update Called with the accumulator of the key of each element and the element, updates the accumulator
+      template<typename _Table, typename _KeyFn, typename _Acc, typename _UpdateFn>
+      static void AggregateInto( const _Range& range, _Table& table, const _KeyFn& keyFn, const _Acc& init, const _UpdateFn& update )
+      {
+         auto step = [&] ( auto&& val )
+         {
+            update( table.FindOrInsert( keyFn( val ), init ), std::forward<decltype( val )>( val ) );
+            return true;
+         };
+         range.Push( step );
+      }
+
+      //! \brief Aggregates each chunk into its own table and merges the tables of the chunks in a tree
+      //! \param merge Called with two accumulators of the same key, combines the second into the first
+      template<typename _Key, typename _KeyFn, typename _Acc, typename _UpdateFn, typename _MergeFn>
+      Containers::HashTable<_Key, _Acc> ParallelAggregate( const _KeyFn& keyFn, const _Acc& init, const _UpdateFn& update,
+                                                           const _MergeFn& merge, const Parallel& policy ) const
+      {
+         using _Table = Containers::HashTable<_Key, _Acc>;
+
+         std::vector<_Table> partials;
+         bool split = ForEachChunk( policy, [&partials] ( size_t chunkCount ) { partials.resize( chunkCount ); },
+                                    [&] ( size_t chunk, const _Range& range )
+         {
+            AggregateInto( range, partials[chunk], keyFn, init, update );
+         } );
+
+         if ( !split )
+         {
+            _Table table;
+            AggregateInto( _range, table, keyFn, init, update );
+            return table;
+         }
+
+         //Merging the right table of each pair into the left one keeps the order of the keys and the chunks
+         for ( size_t stride = 1; stride < partials.size(); stride *= 2 )
+         {
+            size_t pairCount = ( partials.size() + 2 * stride - 1 ) / ( 2 * stride );
+            policy.Pool().ParallelFor( pairCount, [&] ( size_t pair )
+            {
+               size_t left = pair * 2 * stride;
+               size_t right = left + stride;
+               if ( right < partials.size() ) partials[left].Merge( std::move( partials[right] ), merge );
+            } );
+         }
+         return std::move( partials[0] );
+      }
+
+      //! \brief Keeps the current minimum in place and only copies an element that is smaller
+      struct MinUpdate
+      {
+         void operator()( Optional<_ValType>& best, const _ValType& val ) const
+         {
+            if ( best && !( val < best.val ) ) return;
+            best.val = val;
+            best.exists = true;
+         }
+      };
+
+      //! \brief Keeps the current maximum in place and only copies an element that is larger
+      struct MaxUpdate
+      {
+         void operator()( Optional<_ValType>& best, const _ValType& val ) const
+         {
+            if ( best && !( best.val < val ) ) return;
+            best.val = val;
+            best.exists = true;
+         }
+      };
+
+      struct MinCombine
+      {
+         Optional<_ValType> operator()( const Optional<_ValType>& l, const Optional<_ValType>& r ) const
+         {
+            return ( !l || ( r && r.val < l.val ) ) ? r : l;
+         }
+      };
+
+      struct MaxCombine
+      {
+         Optional<_ValType> operator()( const Optional<_ValType>& l, const Optional<_ValType>& r ) const
+         {
+            return ( !l || ( r && l.val < r.val ) ) ? r : l;
+         }
+      };
+
+      std::vector<_ValType> ToVectorParallel( const Parallel& policy, std::false_type ) const
+      {
+         std::vector<std::vector<_ValType>> chunks;
+         bool split = ForEachChunk( policy, [&chunks] ( size_t chunkCount ) { chunks.resize( chunkCount ); },
+                                    [&chunks] ( size_t chunk, const _Range& range )
+         {
+            auto& buffer = chunks[chunk];
+            if ( _Range::_SizeKnown::value ) buffer.reserve( range.SizeHint() );
+            auto append = [&buffer] ( auto&& val )
+            {
+               buffer.push_back( std::forward<decltype( val )>( val ) );
+               return true;
+            };
+            range.Push( append );
+         } );
+         if ( !split ) return ToVector();
+
+         std::vector<size_t> offsets( chunks.size() + 1, 0 );
+         for ( size_t i = 0; i < chunks.size(); i++ ) offsets[i + 1] = offsets[i] + chunks[i].size();
+
+         std::vector<_ValType> ret;
+         if constexpr ( std::is_default_constructible_v<_ValType> && std::is_move_assignable_v<_ValType> )
+         {
+            ret.resize( offsets.back() );
+            policy.Pool().ParallelFor( chunks.size(), [&] ( size_t chunk )
+            {
+               std::move( chunks[chunk].begin(), chunks[chunk].end(), ret.begin() + offsets[chunk] );
+            } );
+         }
+         else
+         {
+            //There are no elements to move the buffers into in parallel, so they are appended one after the other
+            ret.reserve( offsets.back() );
+            for ( auto& buffer : chunks )
+            {
+               for ( auto& val : buffer ) ret.push_back( std::move( val ) );
+            }
+         }
+         return ret;
+      }
+
+      //! \brief Parallel ToVector of a filter over a random access source, in two passes over the source
       //!
-      //! A limit, as the name suggests, limits the maximum number of elements in a range to 
-      //! a specific number. The actual number of elements in the range may be lower than the
-      //! limit however.
-      //! \param limit The maximum number of elements 
-      //! \returns A LazyRange with the limit applied
-      LazyRange<_ValType, LazyLimit<_ValType, _Iter>> Limit( size_t limit ) const
+      //! The first pass evaluates the predicate once per element, into one bit per element, and counts the
+      //! selected elements of each chunk. Chunks start at multiples of 64 elements, so that each chunk has its
+      //! own words of the mask. The prefix sum of the counts is the offset of each chunk in the result, to
+      //! which the second pass copies the selected elements of the chunk. Unlike collecting each chunk in a
+      //! buffer, each selected element is copied only once, over a value-initialized element of the result.
+      //! Elements that cannot be default constructed or assigned therefore take the buffered path
+      std::vector<_ValType> ToVectorParallel( const Parallel& policy, std::true_type ) const
       {
-         using _LimitType = LazyLimit<_ValType, _Iter>;
-         using _Ret = LazyRange<_ValType, _LimitType>;
-         
-         auto iter = _LimitType(std::begin(_range), std::end(_range), std::begin(_range), 0, limit);
-         return _Ret( iter );
+         auto first = _range.SourceBegin();
+         size_t count = static_cast<size_t>( _range.SourceEnd() - first );
+         size_t words = ( count + 63 ) / 64;
+         size_t chunkCount = policy.ChunkCount( count );
+
+         std::vector<uint64_t> mask( words );
+         std::vector<size_t> offsets( chunkCount + 1, 0 );
+         policy.Pool().ParallelFor( chunkCount, [&] ( size_t chunk )
+         {
+            size_t selected = 0;
+            for ( size_t word = chunk * words / chunkCount, last = ( chunk + 1 ) * words / chunkCount; word < last; word++ )
+            {
+               size_t base = word * 64;
+               size_t bitCount = std::min( count - base, size_t( 64 ) );
+               uint64_t bits = 0;
+               for ( size_t bit = 0; bit < bitCount; bit++ )
+               {
+                  bits |= static_cast<uint64_t>( _range.Selects( first[base + bit] ) ) << bit;
+               }
+               mask[word] = bits;
+               selected += static_cast<size_t>( Bits::PopCount( bits ) );
+            }
+            offsets[chunk + 1] = selected;
+         } );
+         //There are only a few chunks per thread, so the prefix sum is not worth distributing
+         for ( size_t i = 0; i < chunkCount; i++ ) offsets[i + 1] += offsets[i];
+
+         std::vector<_ValType> ret( offsets.back() );
+         policy.Pool().ParallelFor( chunkCount, [&] ( size_t chunk )
+         {
+            size_t out = offsets[chunk];
+            for ( size_t word = chunk * words / chunkCount, last = ( chunk + 1 ) * words / chunkCount; word < last; word++ )
+            {
+               //Visits the set bits from the lowest, i.e. the selected elements in order
+               for ( uint64_t bits = mask[word]; bits != 0; bits &= bits - 1 )
+               {
+                  ret[out++] = first[word * 64 + static_cast<size_t>( Bits::CountTrailingZeros( bits ) )];
+               }
+            }
+         } );
+         return ret;
       }
 
-      //Container conversion methods
+      std::vector<_ValType> ToVectorBlocked( std::false_type ) const
+      {
+         return ToVector();
+      }
 
-      //! \brief Converts this range to a vector, thus evaluating all elements in the range
-      //! \returns The elements of this range after evaluation, stored in a vector
-      std::vector<_ValType> ToVector() const
+      std::vector<_ValType> ToVectorBlocked( std::true_type ) const
       {
+         auto first = _range.SourceBegin();
+         size_t count = static_cast<size_t>( _range.SourceEnd() - first );
+
          std::vector<_ValType> ret;
-         for ( auto elem : _range )
+         ret.reserve( _Range::_SizeKnown::value ? count : 0 );
+         if ( count == 0 ) return ret;
+
+         const auto* src = &*first;
+         _ValType block[Vectorized::BlockSize];
+         for ( size_t offset = 0; offset < count; offset += Vectorized::BlockSize )
          {
-            ret.push_back( elem );
+            size_t blockCount = count - offset;
+            if ( blockCount > Vectorized::BlockSize ) blockCount = Vectorized::BlockSize;
+
+            size_t resultCount = _range.EvalBlock( src + offset, blockCount, block );
+            ret.insert( ret.end(), block, block + resultCount );
          }
-         return std::move( ret );
+         return ret;
       }
-   private:
+
+      //! \brief Splits the source of this range into chunks and calls chunkFn for each chunk in parallel
+      //! \param policy The parallel execution policy
+      //! \param prepare Called with the number of chunks before any chunk is evaluated
+      //! \param chunkFn Called with the index of each chunk and the range over this chunk
+      //! \returns False if this range can't be split, in which case nothing is called
+      template<typename _PrepareFn, typename _ChunkFn>
+      bool ForEachChunk( const Parallel& policy, _PrepareFn prepare, _ChunkFn chunkFn ) const
+      {
+         return ForEachChunk( policy, prepare, chunkFn, typename _Range::_Splittable() );
+      }
+
+      //! \brief Number of chunks that a parallel evaluation splits this range into, 1 if it can't be split
+      size_t ChunkCount( const Parallel&, std::false_type ) const
+      {
+         return 1;
+      }
+
+      size_t ChunkCount( const Parallel& policy, std::true_type ) const
+      {
+         return policy.ChunkCount( static_cast<size_t>( _range.SourceEnd() - _range.SourceBegin() ) );
+      }
+
+      template<typename _PrepareFn, typename _ChunkFn>
+      bool ForEachChunk( const Parallel&, _PrepareFn, _ChunkFn, std::false_type ) const
+      {
+         return false;
+      }
+
+      template<typename _PrepareFn, typename _ChunkFn>
+      bool ForEachChunk( const Parallel& policy, _PrepareFn prepare, _ChunkFn chunkFn, std::true_type ) const
+      {
+         auto first = _range.SourceBegin();
+         size_t count = static_cast<size_t>( _range.SourceEnd() - first );
+         size_t chunkCount = policy.ChunkCount( count );
+
+         prepare( chunkCount );
+         policy.Pool().ParallelFor( chunkCount, [&] ( size_t chunk )
+         {
+            auto chunkBegin = first + chunk * count / chunkCount;
+            auto chunkEnd = first + ( chunk + 1 ) * count / chunkCount;
+            chunkFn( chunk, _range.Rebase( chunkBegin, chunkEnd ) );
+         } );
+         return true;
+      }
+
       _Range _range;
    };
 
+   //! \brief Chain of lazy operations that is described once and then applied to any number of containers
+   //!
+   //! Each operation stores its function once, in the pipeline. The operations of the ranges that Bind returns
+   //! only refer to these functions, so binding the pipeline to a container, and copying or iterating the bound
+   //! range, never copies or allocates a function, e.g. a std::function with a large capture. Binding only
+   //! rebases the prepared chain onto the container, as a parallel evaluation does for its chunks. A bound
+   //! range must therefore not outlive the pipeline, nor the container.
+   //!
+   //! Only operations that can be rebased onto another source are offered: Filter, Map, FlatMap and Limit. Any
+   //! operation can be appended to a bound range. With LAZY_INSTRUMENTATION, all ranges bound to a pipeline
+   //! report into the same statistics
+   //! \tparam _Cont Type of the containers the pipeline is bound to
+   //! \tparam _Lazy Type of the LazyRange that Bind returns
+   template<typename _Cont,
+            typename _Lazy>
+   class Pipeline
+   {
+      template<typename, typename> friend class Pipeline;
+      template<typename _Next> using _Then = Pipeline<_Cont, _Next>;
+   public:
+      using _SourceIter = typename _Cont::const_iterator;
+
+      //! \brief Creates a pipeline without any operations, see Prepare
+      explicit Pipeline( const _Lazy& prototype ) :
+         _prototype( prototype )
+      {
+      }
+
+      //! \brief Appends a filter operation to this pipeline
+      //! \param pred Predicate for the filter operation, moved into the pipeline
+      template<typename _Fn>
+      _Then<decltype( std::declval<const _Lazy&>().Filter( std::declval<_FnRef<_Fn>>() ) )> Filter( _Fn pred ) const
+      {
+         auto fn = std::make_shared<const _Fn>( std::move( pred ) );
+         return Then( _prototype.Filter( _FnRef<_Fn>( fn.get() ) ), fn );
+      }
+
+      //! \brief Appends a map operation to this pipeline
+      //! \param map The map function, moved into the pipeline
+      template<typename _Fn>
+      _Then<decltype( std::declval<const _Lazy&>().Map( std::declval<_FnRef<_Fn>>() ) )> Map( _Fn map ) const
+      {
+         auto fn = std::make_shared<const _Fn>( std::move( map ) );
+         return Then( _prototype.Map( _FnRef<_Fn>( fn.get() ) ), fn );
+      }
+
+      //! \brief Appends a flat map operation to this pipeline
+      //! \param fn Returns a range of elements for each element, moved into the pipeline
+      template<typename _Fn>
+      _Then<decltype( std::declval<const _Lazy&>().FlatMap( std::declval<_FnRef<_Fn>>() ) )> FlatMap( _Fn fn ) const
+      {
+         auto stored = std::make_shared<const _Fn>( std::move( fn ) );
+         return Then( _prototype.FlatMap( _FnRef<_Fn>( stored.get() ) ), stored );
+      }
+
+      //! \brief Appends a limit to this pipeline
+      _Then<decltype( std::declval<const _Lazy&>().Limit( size_t() ) )> Limit( size_t limit ) const
+      {
+         return Then( _prototype.Limit( limit ), nullptr );
+      }
+
+      //! \brief Applies this pipeline to the given container, without copying any function
+      //! \param container The container, has to outlive the returned range
+      //! \returns The same range as applying the operations of this pipeline to MakeLazy( container )
+      _Lazy Bind( const _Cont& container ) const &
+      {
+         return Bind( std::begin( container ), std::end( container ) );
+      }
+
+      //! \brief Applies this pipeline to a subrange of a container, without copying any function
+      _Lazy Bind( _SourceIter first, _SourceIter last ) const &
+      {
+         return _Lazy( _prototype._range.Rebase( first, last ) );
+      }
+
+      //! \brief The bound range refers to the functions of the pipeline, so a temporary pipeline can't be bound
+      _Lazy Bind( const _Cont& container ) const && = delete;
+      _Lazy Bind( _SourceIter first, _SourceIter last ) const && = delete;
+   private:
+      //! \brief Returns a pipeline with the given prototype, which keeps the functions of this one alive,
+      //!        along with the given function
+      template<typename _Next>
+      _Then<_Next> Then( const _Next& prototype, std::shared_ptr<const void> fn ) const
+      {
+         _Then<_Next> ret( prototype );
+         ret._fns = _fns;
+         if ( fn ) ret._fns.push_back( std::move( fn ) );
+         return ret;
+      }
+
+      //! Chain of operations on an empty source, which is rebased onto the containers
+      _Lazy _prototype;
+      //! The functions the operations of the prototype refer to
+      std::vector<std::shared_ptr<const void>> _fns;
+   };
+
 #pragma endregion
 
 #pragma region MakeFunction
@@ -518,6 +4602,41 @@ namespace Lazy
       return _Ret( _Range( container ) );
    }
 
+   //! \brief Returns a LazyRange that takes ownership of the given container
+   //!
+   //! The container is moved into the range, so the range can outlive the original variable, e.g. when
+   //! MakeLazy is called with a temporary. Copies of the range and all ranges created from it share the container,
+   //! so its elements are passed on as const references and never moved out. Ranges of move-only elements can
+   //! therefore only be collected with ToVector after mapping the elements to new values
+   //! \param container Any container that supports iterators
+   //! \returns A LazyRange of the given container
+   //! \tparam _Cont The container type
+   template<typename _Cont,
+            typename = typename std::enable_if<!std::is_lvalue_reference<_Cont>::value>::type,
+            typename _ValType = typename _Cont::value_type,
+            typename _IterType = _OwningIterator<typename std::remove_const<_Cont>::type>>
+   LazyRange<_ValType, ContainerRange<_Cont, _ValType, _IterType>> MakeLazy( _Cont&& container )
+   {
+      using _Range = ContainerRange<_Cont, _ValType, _IterType>;
+      using _Ret = LazyRange<_ValType, _Range>;
+
+      auto owned = std::make_shared<const typename std::remove_const<_Cont>::type>( std::move( container ) );
+      return _Ret( _Range( _IterType( owned, std::begin( *owned ) ), _IterType( owned, std::end( *owned ) ) ) );
+   }
+
+   //! \brief Returns an empty Pipeline for containers of the given type, to which operations are appended
+   //!
+   //! Example: auto evens = Prepare<std::vector<int>>().Filter( isEven ); evens.Bind( vec ).ToVector();
+   //! \tparam _Cont The container type
+   template<typename _Cont,
+            typename _ValType = typename _Cont::value_type>
+   Pipeline<_Cont, LazyRange<_ValType, ContainerRange<_Cont>>> Prepare()
+   {
+      using _Range = ContainerRange<_Cont>;
+      using _Iter = typename _Cont::const_iterator;
+      return Pipeline<_Cont, LazyRange<_ValType, _Range>>( LazyRange<_ValType, _Range>( _Range( _Iter(), _Iter() ) ) );
+   }
+
 #pragma endregion
 
 }
\ No newline at end of file
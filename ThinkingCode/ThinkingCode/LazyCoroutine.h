@@ -0,0 +1,302 @@
+#pragma once
+
+#include "Lazy.h"
+#include "ThreadPool.h"
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace Lazy
+{
+
+#pragma region Generator
+
+   //! \brief Coroutine that produces a sequence of values with co_yield
+   //!
+   //! A generator is a container-like source for MakeLazy. The coroutine only runs when the next value is
+   //! requested, so it can produce an infinite sequence as long as the range is limited. A generator can only
+   //! be iterated once, iterating it again continues where the last iteration stopped. Exceptions that escape
+   //! the coroutine are rethrown where the value is requested
+   //! \tparam _ValType Type of the values
+   template<typename _ValType>
+   class Generator
+   {
+   public:
+      struct promise_type
+      {
+         Generator get_return_object()
+         {
+            return Generator( std::coroutine_handle<promise_type>::from_promise( *this ) );
+         }
+
+         std::suspend_always initial_suspend() noexcept
+         {
+            return {};
+         }
+
+         std::suspend_always final_suspend() noexcept
+         {
+            return {};
+         }
+
+         //! \brief Only keeps the address of the value, which lives until the coroutine is resumed
+         std::suspend_always yield_value( const _ValType& val ) noexcept
+         {
+            current = std::addressof( val );
+            return {};
+         }
+
+         void return_void()
+         {
+         }
+
+         void unhandled_exception()
+         {
+            error = std::current_exception();
+         }
+
+         const _ValType* current = nullptr;
+         std::exception_ptr error;
+         bool started = false;
+      };
+
+      using _Handle = std::coroutine_handle<promise_type>;
+
+      //! \brief Input iterator over the values of a generator
+      //!
+      //! The coroutine is started when the first value is requested, not when the iterator is created
+      class const_iterator : public std::iterator<std::input_iterator_tag, _ValType, ptrdiff_t, const _ValType*, const _ValType&>
+      {
+      public:
+         explicit const_iterator( _Handle handle = nullptr ) :
+            _handle( handle )
+         {
+         }
+
+         const _ValType& operator*( ) const
+         {
+            if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+            return *_handle.promise().current;
+         }
+
+         const_iterator& operator++( )
+         {
+            if ( !IsAtEnd() ) Resume();
+            return *this;
+         }
+
+         bool operator==( const const_iterator& other ) const
+         {
+            bool atEnd = IsAtEnd();
+            if ( atEnd || other.IsAtEnd() ) return atEnd == other.IsAtEnd();
+            return _handle == other._handle;
+         }
+
+         bool operator!=( const const_iterator& other ) const
+         {
+            return !operator==( other );
+         }
+      private:
+         bool IsAtEnd() const
+         {
+            if ( !_handle ) return true;
+            if ( !_handle.promise().started )
+            {
+               _handle.promise().started = true;
+               Resume();
+            }
+            return _handle.done();
+         }
+
+         void Resume() const
+         {
+            _handle.resume();
+            if ( _handle.promise().error ) std::rethrow_exception( std::exchange( _handle.promise().error, nullptr ) );
+         }
+
+         _Handle _handle;
+      };
+
+      using value_type = _ValType;
+      using iterator = const_iterator;
+
+      Generator( Generator&& other ) :
+         _handle( std::exchange( other._handle, nullptr ) )
+      {
+      }
+
+      Generator& operator=( Generator&& other )
+      {
+         if ( this == &other ) return *this;
+         if ( _handle ) _handle.destroy();
+         _handle = std::exchange( other._handle, nullptr );
+         return *this;
+      }
+
+      Generator( const Generator& ) = delete;
+      Generator& operator=( const Generator& ) = delete;
+
+      ~Generator()
+      {
+         if ( _handle ) _handle.destroy();
+      }
+
+      const_iterator begin() const
+      {
+         return const_iterator( _handle );
+      }
+
+      const_iterator end() const
+      {
+         return const_iterator();
+      }
+   private:
+      explicit Generator( _Handle handle ) :
+         _handle( handle )
+      {
+      }
+
+      _Handle _handle;
+   };
+
+#pragma endregion
+
+#pragma region AsyncTerminals
+
+   //! \brief Stores the result of an asynchronous operation, which may be void
+   template<typename _Result>
+   struct _AsyncResult
+   {
+      template<typename _Fn>
+      void Set( _Fn& fn )
+      {
+         value.emplace( fn() );
+      }
+
+      _Result Get()
+      {
+         return std::move( *value );
+      }
+
+      std::optional<_Result> value;
+   };
+
+   template<>
+   struct _AsyncResult<void>
+   {
+      template<typename _Fn>
+      void Set( _Fn& fn )
+      {
+         fn();
+      }
+
+      void Get()
+      {
+      }
+   };
+
+   //! \brief Awaitable that evaluates a terminal operation on a thread pool
+   //!
+   //! The awaiting coroutine is suspended while the operation runs on a worker thread and is resumed on that
+   //! thread afterwards, so no thread blocks while waiting. Exceptions of the operation are rethrown in the
+   //! awaiting coroutine. If the pool has no worker threads, the operation runs without suspending
+   //! \tparam _Fn Type of the function that evaluates the operation
+   template<typename _Fn>
+   class AsyncTerminal
+   {
+   public:
+      using _Result = decltype( std::declval<_Fn&>()() );
+
+      AsyncTerminal( _Fn fn, Threading::ThreadPool& pool ) :
+         _fn( std::move( fn ) ),
+         _pool( pool ),
+         _done( false )
+      {
+      }
+
+      bool await_ready() const
+      {
+         return _pool.ThreadCount() == 0;
+      }
+
+      void await_suspend( std::coroutine_handle<> awaiting )
+      {
+         _pool.Post( [this, awaiting] ()
+         {
+            Evaluate();
+            awaiting.resume();
+         } );
+      }
+
+      _Result await_resume()
+      {
+         if ( !_done ) Evaluate();
+         if ( _error ) std::rethrow_exception( _error );
+         return _result.Get();
+      }
+   private:
+      void Evaluate()
+      {
+         try
+         {
+            _result.Set( _fn );
+         }
+         catch ( ... )
+         {
+            _error = std::current_exception();
+         }
+         _done = true;
+      }
+
+      _Fn _fn;
+      Threading::ThreadPool& _pool;
+      _AsyncResult<_Result> _result;
+      std::exception_ptr _error;
+      bool _done;
+   };
+
+   //! \brief Evaluates any terminal operation of a range asynchronously
+   //!
+   //! The range is copied into the operation, but the container it is based on is not, so the container has
+   //! to stay alive until the operation is finished. Use MakeLazy with an rvalue to let the range own it
+   //! \param range The range to evaluate
+   //! \param terminal Called with the range on a worker thread, e.g. [] ( const auto& range ) { return range.Sum(); }
+   //! \param pool The thread pool to use, the shared thread pool if this is null
+   //! \returns Awaitable whose result is the result of the terminal operation
+   template<typename _Range, typename _TerminalFn>
+   auto Async( const _Range& range, _TerminalFn terminal, Threading::ThreadPool* pool = nullptr )
+   {
+      auto evaluate = [range, terminal] () { return terminal( range ); };
+      return AsyncTerminal<decltype( evaluate )>( std::move( evaluate ), pool ? *pool : Threading::ThreadPool::Shared() );
+   }
+
+   //! \brief Converts the range to a vector asynchronously, see Async
+   template<typename _ValType, typename _Range, typename _Iter>
+   auto ToVectorAsync( const LazyRange<_ValType, _Range, _Iter>& range, Threading::ThreadPool* pool = nullptr )
+   {
+      return Async( range, [] ( const LazyRange<_ValType, _Range, _Iter>& range ) { return range.ToVector(); }, pool );
+   }
+
+   //! \brief Folds the range asynchronously, see Async and LazyRange::Fold
+   template<typename _ValType, typename _Range, typename _Iter, typename _Acc, typename _Fn>
+   auto FoldAsync( const LazyRange<_ValType, _Range, _Iter>& range, _Acc init, _Fn fn, Threading::ThreadPool* pool = nullptr )
+   {
+      return Async( range, [init, fn] ( const LazyRange<_ValType, _Range, _Iter>& range ) { return range.Fold( init, fn ); }, pool );
+   }
+
+   //! \brief Calls the function for each element of the range asynchronously, see Async and LazyRange::ForEach
+   template<typename _ValType, typename _Range, typename _Iter, typename _Fn>
+   auto ForEachAsync( const LazyRange<_ValType, _Range, _Iter>& range, _Fn fn, Threading::ThreadPool* pool = nullptr )
+   {
+      return Async( range, [fn] ( const LazyRange<_ValType, _Range, _Iter>& range ) { range.ForEach( fn ); }, pool );
+   }
+
+#pragma endregion
+
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+//Sources for Lazy that read a file incrementally. The ranges behave like containers, so they plug into
+//MakeLazy like any other container:
+//
+//   auto errors = Lazy::MakeLazy( Lazy::ReadLines( "server.log" ) ).Filter( ... ).Count();
+//
+//Only a bounded buffer is kept in memory, no matter how large the file is. Iterators of these ranges are
+//input iterators: copies of an iterator share their position in the file. Each iteration of the range
+//opens the file again
+
+namespace Lazy
+{
+
+   //! \brief Reads the lines of a file through a buffer of fixed size
+   //!
+   //! The buffer only grows if a single line is larger than the buffer
+   class _LineReader
+   {
+   public:
+      using value_type = std::string_view;
+
+      _LineReader( const std::string& path, size_t bufferSize ) :
+         _stream( path, std::ios::binary ),
+         _buffer( bufferSize > 0 ? bufferSize : 1 ),
+         _begin( 0 ),
+         _end( 0 ),
+         _next( 0 ),
+         _atEnd( false )
+      {
+         if ( !_stream ) throw std::runtime_error( "Could not open file!" );
+         Next();
+      }
+
+      bool AtEnd() const
+      {
+         return _atEnd;
+      }
+
+      //! \brief The current line without the line break, valid until Next is called
+      const std::string_view& Current() const
+      {
+         return _line;
+      }
+
+      void Next()
+      {
+         _begin = _next;
+         for ( ;; )
+         {
+            for ( size_t idx = _begin; idx < _end; idx++ )
+            {
+               if ( _buffer[idx] == '\n' )
+               {
+                  SetLine( idx );
+                  _next = idx + 1;
+                  return;
+               }
+            }
+
+            if ( !Fill() )
+            {
+               //The last line does not need a line break
+               if ( _begin == _end )
+               {
+                  _atEnd = true;
+                  _line = std::string_view();
+                  return;
+               }
+               SetLine( _end );
+               _next = _end;
+               return;
+            }
+         }
+      }
+   private:
+      void SetLine( size_t lineEnd )
+      {
+         size_t length = lineEnd - _begin;
+         if ( length > 0 && _buffer[_begin + length - 1] == '\r' ) length--;
+         _line = std::string_view( _buffer.data() + _begin, length );
+      }
+
+      //! \brief Moves the current partial line to the front of the buffer and reads more data behind it
+      //! \returns False if the end of the file was reached
+      bool Fill()
+      {
+         size_t pending = _end - _begin;
+         if ( _begin > 0 )
+         {
+            std::copy( _buffer.begin() + _begin, _buffer.begin() + _end, _buffer.begin() );
+            _begin = 0;
+            _end = pending;
+         }
+         if ( _end == _buffer.size() ) _buffer.resize( _buffer.size() * 2 );
+
+         _stream.read( _buffer.data() + _end, static_cast<std::streamsize>( _buffer.size() - _end ) );
+         size_t read = static_cast<size_t>( _stream.gcount() );
+         _end += read;
+         return read > 0;
+      }
+
+      std::ifstream _stream;
+      std::vector<char> _buffer;
+      size_t _begin;
+      size_t _end;
+      size_t _next;
+      std::string_view _line;
+      bool _atEnd;
+   };
+
+   //! \brief Reads fixed-size binary records from a file through a buffer of fixed size
+   //!
+   //! Trailing bytes that don't form a complete record are ignored
+   //! \tparam _Record Type of the records, has to be trivially copyable
+   template<typename _Record>
+   class _RecordReader
+   {
+      static_assert( std::is_trivially_copyable<_Record>::value, "Records have to be trivially copyable!" );
+   public:
+      using value_type = _Record;
+
+      _RecordReader( const std::string& path, size_t bufferRecords ) :
+         _stream( path, std::ios::binary ),
+         _records( bufferRecords > 0 ? bufferRecords : 1 ),
+         _cur( 0 ),
+         _count( 0 )
+      {
+         if ( !_stream ) throw std::runtime_error( "Could not open file!" );
+         Fill();
+      }
+
+      bool AtEnd() const
+      {
+         return _cur == _count;
+      }
+
+      //! \brief The current record, valid until Next is called
+      const _Record& Current() const
+      {
+         return _records[_cur];
+      }
+
+      void Next()
+      {
+         if ( ++_cur == _count ) Fill();
+      }
+   private:
+      void Fill()
+      {
+         _stream.read( reinterpret_cast<char*>( _records.data() ), static_cast<std::streamsize>( _records.size() * sizeof( _Record ) ) );
+         _count = static_cast<size_t>( _stream.gcount() ) / sizeof( _Record );
+         _cur = 0;
+      }
+
+      std::ifstream _stream;
+      std::vector<_Record> _records;
+      size_t _cur;
+      size_t _count;
+   };
+
+   //! \brief Input iterator over a file that is read by a _Reader
+   //!
+   //! The file is opened when the iterator is first dereferenced, incremented or compared with the end
+   //! iterator. Copies that are made before that each read the file on their own, copies that are made
+   //! afterwards share their position
+   //! \tparam _Reader The reader type, e.g. _LineReader
+   template<typename _Reader>
+   class StreamIterator : public std::iterator<std::input_iterator_tag, typename _Reader::value_type>
+   {
+   public:
+      struct _Source
+      {
+         std::string path;
+         size_t bufferSize;
+      };
+
+      //! \brief Creates the end iterator
+      StreamIterator()
+      {
+      }
+
+      explicit StreamIterator( const std::shared_ptr<const _Source>& source ) :
+         _source( source )
+      {
+      }
+
+      const typename _Reader::value_type& operator*( ) const
+      {
+         if ( IsAtEnd() ) throw std::runtime_error( "Dereferencing end iterator!" );
+         return _reader->Current();
+      }
+
+      StreamIterator& operator++( )
+      {
+         if ( !IsAtEnd() ) _reader->Next();
+         return *this;
+      }
+
+      bool operator==( const StreamIterator& other ) const
+      {
+         //Only the comparison with the end iterator has to open the file
+         if ( !_source || !other._source ) return IsAtEnd() == other.IsAtEnd();
+         return _source == other._source &&
+                _reader == other._reader;
+      }
+
+      bool operator!=( const StreamIterator& other ) const
+      {
+         return !operator==( other );
+      }
+
+      bool IsAtEnd() const
+      {
+         if ( !_source ) return true;
+         if ( !_reader ) _reader = std::make_shared<_Reader>( _source->path, _source->bufferSize );
+         return _reader->AtEnd();
+      }
+   private:
+      std::shared_ptr<const _Source> _source;
+      mutable std::shared_ptr<_Reader> _reader;
+   };
+
+   //! \brief Container-like range over a file that is read by a _Reader
+   template<typename _Reader>
+   class StreamRange
+   {
+   public:
+      using value_type = typename _Reader::value_type;
+      using const_iterator = StreamIterator<_Reader>;
+
+      StreamRange( const std::string& path, size_t bufferSize ) :
+         _source( std::make_shared<_Source>( _Source{ path, bufferSize } ) )
+      {
+      }
+
+      const_iterator begin() const
+      {
+         return const_iterator( _source );
+      }
+
+      const_iterator end() const
+      {
+         return const_iterator();
+      }
+   private:
+      using _Source = typename const_iterator::_Source;
+
+      std::shared_ptr<const _Source> _source;
+   };
+
+   using LineRange = StreamRange<_LineReader>;
+
+   template<typename _Record>
+   using RecordRange = StreamRange<_RecordReader<_Record>>;
+
+   //! \brief Returns a range over the lines of a text file, without the line breaks
+   //!
+   //! The lines are string_views into a reused buffer, so they are only valid until the next line is read
+   //! \param path Path of the file
+   //! \param bufferSize Size of the read buffer in bytes
+   inline LineRange ReadLines( const std::string& path, size_t bufferSize = 64 * 1024 )
+   {
+      return LineRange( path, bufferSize );
+   }
+
+   //! \brief Returns a range over the fixed-size binary records in a file
+   //! \param path Path of the file
+   //! \param bufferRecords Number of records that are read at once
+   //! \tparam _Record Type of the records, has to be trivially copyable
+   template<typename _Record>
+   RecordRange<_Record> ReadRecords( const std::string& path, size_t bufferRecords = 4096 )
+   {
+      return RecordRange<_Record>( path, bufferRecords );
+   }
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 //Solving propositional logic problems using template metaprogramming
 
@@ -200,7 +202,7 @@ struct BuildExpr
 public:
    static Exp Build( Truths&&... args )
    {
-      return DoBuild( std::forward<Truths>( args )..., Exp::NArgs( ) );
+      return DoBuild( std::forward<Truths>( args )..., typename Exp::NArgs( ) );
    }
 private:
    static Exp DoBuild( Truths&&... args, NoArg )
@@ -210,14 +212,14 @@ private:
 
    static Exp DoBuild( Truths&&... args, OneArg )
    {
-      return Exp( BuildExpr<Exp::Arg1, Truths...>::DoBuild( std::forward<Truths>( args )..., Exp::Arg1::NArgs( ) ) );
+      return Exp( BuildExpr<typename Exp::Arg1, Truths...>::DoBuild( std::forward<Truths>( args )..., typename Exp::Arg1::NArgs( ) ) );
    }
 
    static Exp DoBuild( Truths&&... args, TwoArgs )
    {
       return Exp( 
-         BuildExpr<Exp::Arg1, Truths...>::DoBuild( std::forward<Truths>( args )..., Exp::Arg1::NArgs( ) ),
-         BuildExpr<Exp::Arg2, Truths...>::DoBuild( std::forward<Truths>( args )..., Exp::Arg2::NArgs( ) ) );
+         BuildExpr<typename Exp::Arg1, Truths...>::DoBuild( std::forward<Truths>( args )..., typename Exp::Arg1::NArgs( ) ),
+         BuildExpr<typename Exp::Arg2, Truths...>::DoBuild( std::forward<Truths>( args )..., typename Exp::Arg2::NArgs( ) ) );
    }
 };
 
@@ -280,7 +282,7 @@ Validity CheckValidity()
    bool first = BuildExpr<Exp, T1, T2, T3>::Build( false, false, false )();
    for ( int i = 1; i < 8; i++ )
    {
-      bool next = BuildExpr<Exp, T1, T2, T3>::Build( i / 2 != 0, i % 2 != 0, i % 4 != 0 )();
+      bool next = BuildExpr<Exp, T1, T2, T3>::Build( ( i & 4 ) != 0, ( i & 2 ) != 0, ( i & 1 ) != 0 )();
       if ( next != first ) return Validity::Unknown;
    }
    return first ? Validity::Always : Validity::Never;
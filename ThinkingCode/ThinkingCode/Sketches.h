@@ -0,0 +1,297 @@
+#pragma once
+
+#include "Bits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//Summaries of streams that use a fixed amount of memory, no matter how many elements are added, and answer
+//questions about the stream approximately. Two sketches of the same kind and size can be merged into a sketch
+//of both streams, so separate parts of a stream can be summarized independently, e.g. on different threads
+
+namespace Sketches
+{
+
+   //! \brief Estimates the number of distinct elements of a stream from the hashes of its elements
+   //!
+   //! Each hash selects one of 2^precision registers, which keeps the largest number of leading zeros of the
+   //! remaining hash bits. Seeing n zeros takes about 2^n distinct hashes, so the registers together give an
+   //! estimate of the number of distinct hashes. Small counts are estimated from the number of empty registers
+   //! instead. The standard error is about 1.04 / sqrt( 2^precision ), i.e. 1.6% for the default precision
+   class HyperLogLog
+   {
+   public:
+      //! \brief Creates an empty sketch
+      //! \param precision Base 2 logarithm of the number of registers, between 4 and 18. Each register takes a byte
+      explicit HyperLogLog( unsigned precision = 12 ) :
+         _precision( precision )
+      {
+         if ( precision < 4 || precision > 18 ) throw std::runtime_error( "Precision must be between 4 and 18" );
+         _registers.assign( size_t( 1 ) << precision, 0 );
+      }
+
+      //! \brief Adds an element by its hash
+      //! \param hash Hash of the element, e.g. from std::hash. It is mixed here, so weak hashes are fine
+      void Add( uint64_t hash )
+      {
+         hash = Mix( hash );
+         size_t index = static_cast<size_t>( hash >> ( 64 - _precision ) );
+         //The marker bit limits the count of leading zeros to the bits that did not select the register
+         uint64_t rest = ( hash << _precision ) | ( uint64_t( 1 ) << ( _precision - 1 ) );
+         uint8_t rank = static_cast<uint8_t>( Bits::CountLeadingZeros( rest ) + 1 );
+         if ( rank > _registers[index] ) _registers[index] = rank;
+      }
+
+      //! \brief Adds all elements of another sketch with the same precision to this one
+      void Merge( const HyperLogLog& other )
+      {
+         if ( other._precision != _precision ) throw std::runtime_error( "Sketches with different precisions can't be merged" );
+         for ( size_t i = 0; i < _registers.size(); i++ ) _registers[i] = std::max( _registers[i], other._registers[i] );
+      }
+
+      //! \brief Returns the estimated number of distinct elements that were added
+      double Estimate() const
+      {
+         double count = static_cast<double>( _registers.size() );
+         double sum = 0;
+         size_t empty = 0;
+         for ( auto reg : _registers )
+         {
+            sum += std::ldexp( 1.0, -static_cast<int>( reg ) );
+            empty += reg == 0;
+         }
+
+         double estimate = Alpha() * count * count / sum;
+         //Linear counting is more accurate while many registers are still empty
+         if ( estimate <= 2.5 * count && empty > 0 ) estimate = count * std::log( count / static_cast<double>( empty ) );
+         return estimate;
+      }
+
+      unsigned Precision() const
+      {
+         return _precision;
+      }
+   private:
+      //! \brief Bias correction of the raw estimate for the number of registers
+      double Alpha() const
+      {
+         switch ( _registers.size() )
+         {
+            case 16: return 0.673;
+            case 32: return 0.697;
+            case 64: return 0.709;
+            default: return 0.7213 / ( 1.0 + 1.079 / static_cast<double>( _registers.size() ) );
+         }
+      }
+
+      //! \brief Finalizer of MurmurHash3, every input bit affects every output bit
+      static uint64_t Mix( uint64_t hash )
+      {
+         hash ^= hash >> 33;
+         hash *= 0xFF51AFD7ED558CCDull;
+         hash ^= hash >> 33;
+         hash *= 0xC4CEB9FE1A85EC53ull;
+         hash ^= hash >> 33;
+         return hash;
+      }
+
+      unsigned _precision;
+      std::vector<uint8_t> _registers;
+   };
+
+   //! \brief Estimates the quantiles of a stream of ordered elements
+   //!
+   //! A KLL sketch: elements are kept in levels, each element of level h stands for 2^h elements of the stream.
+   //! When the sketch is full, every other element of the lowest full level, in sorted order and starting at
+   //! the first or the second at random, is promoted to the next level. Only the lowest level has to be sorted
+   //! for this, promoted elements are merged into the sorted levels above. The capacities of the levels shrink by 2/3
+   //! towards the lowest level, except for the lowest level itself, so the sketch holds less than about 4k
+   //! elements plus eight per level. Until k elements were added, quantiles are exact. With the default k of 200, the rank of a returned quantile is
+   //! typically off by less than 1% of the number of elements
+   //! \tparam _ValType Type of the elements
+   //! \tparam _Compare Order of the elements
+   template<typename _ValType,
+            typename _Compare = std::less<_ValType>>
+   class QuantileSketch
+   {
+   public:
+      //! \brief Creates an empty sketch
+      //! \param k Capacity of the highest level, controls the accuracy and the size of the sketch. At least 8
+      explicit QuantileSketch( size_t k = 200, const _Compare& compare = _Compare() ) :
+         _k( std::max( k, size_t( 8 ) ) ),
+         _compare( compare ),
+         _levels( 1 ),
+         _count( 0 ),
+         _size( 0 ),
+         _random( 0x9E3779B97F4A7C15ull )
+      {
+         _capacity = TotalCapacity();
+      }
+
+      void Add( const _ValType& val )
+      {
+         _levels[0].push_back( val );
+         ++_count;
+         if ( ++_size > _capacity ) Compress();
+      }
+
+      //! \brief Adds all elements of another sketch to this one. Sketches with different k can be merged, the
+      //!        result keeps the k of this sketch
+      void Merge( const QuantileSketch& other )
+      {
+         if ( other._levels.size() > _levels.size() )
+         {
+            _levels.resize( other._levels.size() );
+            _capacity = TotalCapacity();
+         }
+         for ( size_t level = 0; level < other._levels.size(); level++ )
+         {
+            auto& items = other._levels[level];
+            if ( level == 0 ) _levels[0].insert( _levels[0].end(), items.begin(), items.end() );
+            else MergeInto( level, items.begin(), items.end() );
+         }
+         _count += other._count;
+         _size += other._size;
+         if ( _size > _capacity ) Compress();
+      }
+
+      //! \brief Number of elements that were added
+      uint64_t Count() const
+      {
+         return _count;
+      }
+
+      bool Empty() const
+      {
+         return _count == 0;
+      }
+
+      //! \brief Returns the element at the given fraction of the sorted stream, e.g. 0.99 for the 99th percentile
+      //! \param fraction Between 0 for the smallest and 1 for the largest element
+      //! \returns An element that was added, whose rank in the stream is about fraction * Count()
+      _ValType Quantile( double fraction ) const
+      {
+         if ( _count == 0 ) throw std::runtime_error( "Quantile of an empty sketch" );
+         auto items = Weighted();
+         double target = std::min( std::max( fraction, 0.0 ), 1.0 ) * static_cast<double>( _count );
+         uint64_t weight = 0;
+         for ( auto& item : items )
+         {
+            weight += item.second;
+            if ( static_cast<double>( weight ) >= target ) return item.first;
+         }
+         return items.back().first;
+      }
+
+      //! \brief Returns the estimated fraction of the added elements that are less than or equal to val
+      double Rank( const _ValType& val ) const
+      {
+         if ( _count == 0 ) return 0;
+         uint64_t weight = 0;
+         for ( size_t level = 0; level < _levels.size(); level++ )
+         {
+            for ( auto& item : _levels[level] )
+            {
+               if ( !_compare( val, item ) ) weight += uint64_t( 1 ) << level;
+            }
+         }
+         return static_cast<double>( weight ) / static_cast<double>( _count );
+      }
+   private:
+      //! \brief Capacity of the given level, the highest level has capacity k
+      size_t LevelCapacity( size_t level ) const
+      {
+         //Added elements go to the lowest level, which therefore keeps capacity k as well, so that it is only
+         //sorted once for k / 2 added elements. Larger capacities only make the sketch more accurate
+         if ( level == 0 ) return _k;
+         size_t depth = _levels.size() - 1 - level;
+         double capacity = std::ceil( static_cast<double>( _k ) * std::pow( 2.0 / 3.0, static_cast<double>( depth ) ) );
+         return std::max( static_cast<size_t>( capacity ), size_t( 8 ) );
+      }
+
+      //! \brief Capacity of all levels together, which only changes with the number of levels
+      size_t TotalCapacity() const
+      {
+         size_t capacity = 0;
+         for ( size_t level = 0; level < _levels.size(); level++ ) capacity += LevelCapacity( level );
+         return capacity;
+      }
+
+      //! \brief Promotes half of the elements of the lowest full levels, until the sketch is within its capacity
+      void Compress()
+      {
+         while ( _size > _capacity )
+         {
+            size_t level = 0;
+            while ( _levels[level].size() < LevelCapacity( level ) ) level++;
+            if ( level + 1 == _levels.size() )
+            {
+               _levels.emplace_back();
+               _capacity = TotalCapacity();
+            }
+
+            auto& items = _levels[level];
+            if ( level == 0 ) std::sort( items.begin(), items.end(), _compare );
+            //An odd element stays behind, so that the total weight does not change
+            size_t kept = items.size() % 2;
+            size_t offset = kept + NextBit();
+            _promoted.clear();
+            for ( size_t i = offset; i < items.size(); i += 2 ) _promoted.push_back( std::move( items[i] ) );
+            MergeInto( level + 1, _promoted.begin(), _promoted.end() );
+            _size -= ( items.size() - kept ) / 2;
+            items.resize( kept );
+         }
+      }
+
+      //! \brief Merges sorted elements into a level above the lowest one, which are always sorted
+      template<typename _Iter>
+      void MergeInto( size_t level, _Iter first, _Iter last )
+      {
+         auto& items = _levels[level];
+         _merged.clear();
+         std::merge( items.begin(), items.end(), first, last, std::back_inserter( _merged ), _compare );
+         items.swap( _merged );
+      }
+
+      //! \brief All elements with their weights, sorted by element
+      std::vector<std::pair<_ValType, uint64_t>> Weighted() const
+      {
+         std::vector<std::pair<_ValType, uint64_t>> items;
+         items.reserve( _size );
+         for ( size_t level = 0; level < _levels.size(); level++ )
+         {
+            for ( auto& item : _levels[level] ) items.emplace_back( item, uint64_t( 1 ) << level );
+         }
+         std::sort( items.begin(), items.end(), [this] ( const auto& l, const auto& r ) { return _compare( l.first, r.first ); } );
+         return items;
+      }
+
+      //! \brief Random bit from a xorshift generator. Seeded with a constant, so sketches are reproducible
+      size_t NextBit()
+      {
+         _random ^= _random << 13;
+         _random ^= _random >> 7;
+         _random ^= _random << 17;
+         return static_cast<size_t>( _random >> 63 );
+      }
+
+      size_t _k;
+      _Compare _compare;
+      std::vector<std::vector<_ValType>> _levels;
+      uint64_t _count;
+      //! Number of elements in all levels
+      size_t _size;
+      size_t _capacity;
+      uint64_t _random;
+      //Buffers of Compress, kept to reuse their memory
+      std::vector<_ValType> _promoted;
+      std::vector<_ValType> _merged;
+   };
+
+}
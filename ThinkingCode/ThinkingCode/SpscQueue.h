@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace Threading
+{
+
+   //! \brief Bounded lock-free queue for exactly one producer thread and one consumer thread
+   //!
+   //! The elements are stored in a ring buffer. Producer and consumer each own one index and only read the
+   //! index of the other thread when their cached copy of it says that the queue is full or empty. Neither
+   //! side ever blocks, waiting for space or elements is up to the caller
+   //! \tparam _ValType Type of the elements, does not have to be default constructible
+   template<typename _ValType>
+   class SpscQueue
+   {
+   public:
+      //! \brief Creates an empty queue
+      //! \param capacity Minimum number of elements the queue can hold, rounded up to a power of two
+      explicit SpscQueue( size_t capacity ) :
+         _head( 0 ),
+         _cachedTail( 0 ),
+         _tail( 0 ),
+         _cachedHead( 0 )
+      {
+         _capacity = 2;
+         while ( _capacity < capacity ) _capacity *= 2;
+         _mask = _capacity - 1;
+         _slots = static_cast<_ValType*>( ::operator new( _capacity * sizeof( _ValType ) ) );
+      }
+
+      ~SpscQueue()
+      {
+         while ( Front() ) Pop();
+         ::operator delete( _slots );
+      }
+
+      SpscQueue( const SpscQueue& ) = delete;
+      SpscQueue& operator=( const SpscQueue& ) = delete;
+
+      //! \brief Number of elements the queue can hold
+      size_t Capacity() const
+      {
+         return _capacity;
+      }
+
+      //! \brief Appends an element if the queue is not full. Must only be called by the producer
+      //! \param val The element, it is only moved from if it is appended
+      //! \returns False if the queue is full
+      template<typename _Val>
+      bool TryPush( _Val&& val )
+      {
+         size_t tail = _tail.load( std::memory_order_relaxed );
+         if ( tail - _cachedHead == _capacity )
+         {
+            _cachedHead = _head.load( std::memory_order_acquire );
+            if ( tail - _cachedHead == _capacity ) return false;
+         }
+         new ( &_slots[tail & _mask] ) _ValType( std::forward<_Val>( val ) );
+         _tail.store( tail + 1, std::memory_order_release );
+         return true;
+      }
+
+      //! \brief Returns the oldest element, which stays in place until Pop. Must only be called by the consumer
+      //! \returns The oldest element or nullptr if the queue is empty
+      _ValType* Front()
+      {
+         size_t head = _head.load( std::memory_order_relaxed );
+         if ( head == _cachedTail )
+         {
+            _cachedTail = _tail.load( std::memory_order_acquire );
+            if ( head == _cachedTail ) return nullptr;
+         }
+         return &_slots[head & _mask];
+      }
+
+      //! \brief Removes the oldest element. Must only be called by the consumer, after Front returned an element
+      void Pop()
+      {
+         size_t head = _head.load( std::memory_order_relaxed );
+         _slots[head & _mask].~_ValType();
+         _head.store( head + 1, std::memory_order_release );
+      }
+   private:
+      //The indices only grow, the slot of an index is index & _mask. Each side's index and its cached copy
+      //of the other index are on their own cache line, so that the two threads don't invalidate each other's
+      //cache lines with every element
+
+      //! Index of the oldest element, written by the consumer
+      alignas( 64 ) std::atomic<size_t> _head;
+      size_t _cachedTail;
+      //! Index of the next free slot, written by the producer
+      alignas( 64 ) std::atomic<size_t> _tail;
+      size_t _cachedHead;
+
+      alignas( 64 ) _ValType* _slots;
+      size_t _capacity;
+      size_t _mask;
+   };
+
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Threading
+{
+
+   //! \brief A fixed number of worker threads that execute tasks from a shared queue
+   class ThreadPool
+   {
+   public:
+      //! \brief Creates a thread pool
+      //! \param threadCount Number of worker threads. Calls to ParallelFor also do work on the calling thread,
+      //!                    so a pool with N threads runs up to N + 1 tasks at the same time
+      explicit ThreadPool( size_t threadCount ) :
+         _stop( false )
+      {
+         _threads.reserve( threadCount );
+         for ( size_t i = 0; i < threadCount; i++ )
+         {
+            _threads.push_back( std::thread( [this] () { WorkerLoop(); } ) );
+         }
+      }
+
+      ~ThreadPool()
+      {
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _stop = true;
+         }
+         _wake.notify_all();
+         for ( auto& thread : _threads ) thread.join();
+      }
+
+      ThreadPool( const ThreadPool& ) = delete;
+      ThreadPool& operator=( const ThreadPool& ) = delete;
+
+      //! \brief Number of worker threads in this pool
+      size_t ThreadCount() const
+      {
+         return _threads.size();
+      }
+
+      //! \brief Calls fn( i ) for each i in [0;count) and returns once all calls have finished
+      //!
+      //! The calls are distributed over the worker threads and the calling thread. If any call throws, the
+      //! remaining indices are still processed and the first exception is rethrown on the calling thread
+      //! \param count Number of indices
+      //! \param fn Function that is called with each index, has to be safe to call concurrently
+      template<typename _Fn>
+      void ParallelFor( size_t count, const _Fn& fn )
+      {
+         if ( count == 0 ) return;
+
+         struct _Job
+         {
+            std::atomic<size_t> next;
+            std::atomic<size_t> done;
+            size_t count;
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr error;
+         };
+
+         auto job = std::make_shared<_Job>();
+         job->next = 0;
+         job->done = 0;
+         job->count = count;
+
+         //Workers might pick up this task after all indices are done, in which case they return without
+         //touching fn. This is why fn can be captured by reference
+         auto work = [job, &fn] ()
+         {
+            size_t idx;
+            while ( ( idx = job->next++ ) < job->count )
+            {
+               try
+               {
+                  fn( idx );
+               }
+               catch ( ... )
+               {
+                  std::lock_guard<std::mutex> lock( job->mutex );
+                  if ( !job->error ) job->error = std::current_exception();
+               }
+
+               if ( ++job->done == job->count )
+               {
+                  std::lock_guard<std::mutex> lock( job->mutex );
+                  job->finished.notify_all();
+               }
+            }
+         };
+
+         size_t helpers = std::min( _threads.size(), count - 1 );
+         if ( helpers > 0 )
+         {
+            {
+               std::lock_guard<std::mutex> lock( _mutex );
+               for ( size_t i = 0; i < helpers; i++ ) _tasks.push_back( work );
+            }
+            _wake.notify_all();
+         }
+
+         work();
+
+         std::unique_lock<std::mutex> lock( job->mutex );
+         job->finished.wait( lock, [&job] () { return job->done == job->count; } );
+         if ( job->error ) std::rethrow_exception( job->error );
+      }
+
+      //! \brief Runs the task on one of the worker threads and returns without waiting for it
+      //!
+      //! A pool without worker threads runs the task on the calling thread before returning. Exceptions of the
+      //! task are not caught, so the task has to handle them itself
+      //! \param task The task to run
+      void Post( std::function<void()> task )
+      {
+         if ( _threads.empty() )
+         {
+            task();
+            return;
+         }
+
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _tasks.push_back( std::move( task ) );
+         }
+         _wake.notify_one();
+      }
+
+      //! \brief Thread pool that is shared by all parallel operations that don't specify their own pool
+      static ThreadPool& Shared()
+      {
+         static ThreadPool pool( std::max( std::thread::hardware_concurrency(), 1u ) - 1 );
+         return pool;
+      }
+   private:
+      void WorkerLoop()
+      {
+         for ( ;; )
+         {
+            std::function<void()> task;
+            {
+               std::unique_lock<std::mutex> lock( _mutex );
+               _wake.wait( lock, [this] () { return _stop || !_tasks.empty(); } );
+               if ( _stop && _tasks.empty() ) return;
+               task = std::move( _tasks.front() );
+               _tasks.pop_front();
+            }
+            task();
+         }
+      }
+
+      std::vector<std::thread> _threads;
+      std::deque<std::function<void()>> _tasks;
+      std::mutex _mutex;
+      std::condition_variable _wake;
+      bool _stop;
+   };
+
+}
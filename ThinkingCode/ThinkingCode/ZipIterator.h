@@ -10,7 +10,7 @@ namespace Zip
    template<typename T>
    struct _GetIterator
    {
-      using iterator = typename std::conditional< std::is_const<T>::value, 
+      using iterator = typename std::conditional< std::is_const<typename std::remove_reference<T>::type>::value, 
                                                   typename std::remove_reference<T>::type::const_iterator, 
                                                   typename std::remove_reference<T>::type::iterator >::type;
    };
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//Minimal helpers for timing the code examples. Each benchmark reports the fastest of a few runs, which
+//is the most stable number on a machine that is doing other things at the same time. Along with the time,
+//each run counts heap allocations and, where the platform allows it, hardware cache misses
+
+namespace Bench
+{
+
+   //! \brief Number of heap allocations since the start of the program. Counted by the global operator new of
+   //!        the benchmark executable, see ThinkingCode_Bench.cpp
+   extern std::atomic<uint64_t> allocationCount;
+
+   //! \brief Counts the last level cache misses of the calling thread
+   //!
+   //! Uses perf events on Linux. On other platforms, or if the kernel does not allow access to the hardware
+   //! counters, e.g. in a container, the counter is not available and all benchmarks report no cache misses
+   class CacheMissCounter
+   {
+   public:
+      CacheMissCounter() :
+         _fd( -1 )
+      {
+#ifdef __linux__
+         perf_event_attr attr = {};
+         attr.type = PERF_TYPE_HARDWARE;
+         attr.size = sizeof( attr );
+         attr.config = PERF_COUNT_HW_CACHE_MISSES;
+         attr.disabled = 1;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         attr.inherit = 1;
+         _fd = static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+#endif
+      }
+
+      ~CacheMissCounter()
+      {
+#ifdef __linux__
+         if ( _fd >= 0 ) close( _fd );
+#endif
+      }
+
+      CacheMissCounter( const CacheMissCounter& ) = delete;
+      CacheMissCounter& operator=( const CacheMissCounter& ) = delete;
+
+      bool Available() const
+      {
+         return _fd >= 0;
+      }
+
+      void Start()
+      {
+#ifdef __linux__
+         if ( !Available() ) return;
+         ioctl( _fd, PERF_EVENT_IOC_RESET, 0 );
+         ioctl( _fd, PERF_EVENT_IOC_ENABLE, 0 );
+#endif
+      }
+
+      //! \brief Stops counting and returns the number of cache misses since Start
+      uint64_t Stop()
+      {
+         uint64_t count = 0;
+#ifdef __linux__
+         if ( !Available() ) return 0;
+         ioctl( _fd, PERF_EVENT_IOC_DISABLE, 0 );
+         if ( read( _fd, &count, sizeof( count ) ) != sizeof( count ) ) count = 0;
+#endif
+         return count;
+      }
+
+      //! \brief Counter that is shared by all benchmarks
+      static CacheMissCounter& Shared()
+      {
+         static CacheMissCounter counter;
+         return counter;
+      }
+   private:
+      int _fd;
+   };
+
+   //! \brief Result of measuring a benchmark, all numbers are those of the fastest run
+   struct Measurement
+   {
+      //! Duration in milliseconds
+      double ms;
+      //! Number of heap allocations
+      uint64_t allocations;
+      //! Number of cache misses, zero if the counter is not available
+      uint64_t cacheMisses;
+   };
+
+   //! \brief Runs the given function a number of times and returns the measurement of the fastest run
+   //! \param fn The function to measure
+   //! \param runs Number of runs
+   //! \returns The duration, allocations and cache misses of the fastest run
+   template<typename _Fn>
+   Measurement Measure( _Fn fn, size_t runs = 3 )
+   {
+      auto& cacheMisses = CacheMissCounter::Shared();
+      Measurement best = {};
+      for ( size_t run = 0; run < runs; run++ )
+      {
+         uint64_t allocations = allocationCount.load();
+         cacheMisses.Start();
+         auto start = std::chrono::high_resolution_clock::now();
+         fn();
+         auto stop = std::chrono::high_resolution_clock::now();
+         uint64_t misses = cacheMisses.Stop();
+
+         double ms = std::chrono::duration<double, std::milli>( stop - start ).count();
+         if ( run == 0 || ms < best.ms ) best = Measurement{ ms, allocationCount.load() - allocations, misses };
+      }
+      return best;
+   }
+
+   //! \brief Prints the column headers for Report
+   inline void PrintHeader()
+   {
+      printf( "%-52s %13s %15s %12s %12s\n", "", "time", "throughput", "allocs/elem", "misses/elem" );
+   }
+
+   //! \brief Prints the result of a single benchmark
+   //! \param name Name of the benchmark
+   //! \param result The measurement of the benchmark
+   //! \param elements Number of processed elements, used to calculate the throughput and the per element numbers
+   inline void Report( const char* name, const Measurement& result, size_t elements )
+   {
+      double throughput = result.ms > 0 ? elements / ( result.ms * 1000.0 ) : 0;
+      double perElement = elements > 0 ? 1.0 / elements : 0;
+      printf( "%-52s %10.2f ms %7.2f Melem/s %12.6f", name, result.ms, throughput, result.allocations * perElement );
+      if ( CacheMissCounter::Shared().Available() )
+      {
+         printf( " %12.6f\n", result.cacheMisses * perElement );
+      }
+      else
+      {
+         printf( " %12s\n", "n/a" );
+      }
+   }
+
+   //! \brief Keeps the optimizer from removing computations whose result is otherwise unused
+   //!
+   //! The address of the value escapes to code the compiler cannot see through, so the value has to be in
+   //! memory. Unlike storing it to a volatile variable, this works for any type and copies nothing
+   template<typename T>
+   inline void Consume( const T& val )
+   {
+#if defined( __GNUC__ ) || defined( __clang__ )
+      asm volatile( "" : : "g"( &val ) : "memory" );
+#else
+      //No inline assembly on x64, so the address is written to a volatile pointer and the compiler may not
+      //move memory accesses across the barrier
+      static const volatile void* volatile escape;
+      escape = &val;
+      _ReadWriteBarrier();
+#endif
+   }
+
+}
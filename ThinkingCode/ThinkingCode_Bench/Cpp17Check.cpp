@@ -0,0 +1,39 @@
+//Compiled with C++17 by the CMake build, so that Lazy.h stays usable without C++20. Only LazyCoroutine.h needs
+//C++20. Nothing here is run, the operations are only instantiated
+
+#include "Lazy.h"
+#include "LazyFile.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace Cpp17Check
+{
+
+   size_t InstantiateOperations( const std::vector<int>& vec, const std::list<std::string>& words )
+   {
+      auto isEven = [] ( const int& val ) { return val % 2 == 0; };
+      auto range = Lazy::MakeLazy( vec ).Filter( isEven ).Map( [] ( const int& val ) { return val * 3; } ).Limit( 100 );
+      auto it = range.begin();
+      it = range.end();
+
+      size_t count = range.ToVector().size() + range.ToVector( Lazy::Parallel( 16 ) ).size();
+      count += Lazy::MakeLazy( vec ).Filter( isEven ).ToVector( Lazy::Parallel( 16 ) ).size();
+      count += static_cast<size_t>( range.Sum() + range.Min().val + range.Max().val );
+      count += Lazy::MakeLazy( vec ).FlatMap( [] ( const int& val ) { return std::vector<int>( 2, val ); } ).Count();
+      count += Lazy::MakeLazy( vec ).Concat( Lazy::MakeLazy( vec ) ).Chunk( 3 ).Count();
+      count += Lazy::MakeLazy( vec ).Window( 3 ).Count();
+      count += Lazy::MakeLazy( vec ).OrderBy( [] ( const int& val ) { return -val; } ).Limit( 5 ).Count();
+      count += Lazy::MakeLazy( vec ).Distinct( Lazy::BloomPrefilter( 100 ) ).Count();
+      count += Lazy::MakeLazy( words ).Pipelined().Map( [] ( const std::string& word ) { return word.size(); } ).Sum();
+      count += Lazy::MakeLazy( vec ).AggregateBy( [] ( const int& val ) { return val % 7; }, 0, [] ( int acc, const int& val ) { return acc + val; } ).size();
+      count += Lazy::MakeLazy( vec ).CountDistinctApprox( Lazy::Parallel( 16 ) );
+      count += Lazy::MakeLazy( vec ).QuantilesApprox().Count();
+
+      auto pipeline = Lazy::Prepare<std::vector<int>>().Filter( isEven ).Map( [] ( const int& val ) { return val + 1; } );
+      count += pipeline.Bind( vec ).Count();
+      return count;
+   }
+
+}
@@ -0,0 +1,504 @@
+#include "Benchmark.h"
+#include "Lazy.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <version>
+
+#ifdef __cpp_lib_ranges
+#include <ranges>
+#endif
+
+namespace
+{
+
+   void BenchCallables( const std::vector<int>& vec )
+   {
+      auto pred = [] ( const int& val ) { return ( val & 3 ) != 0; };
+      auto map = [] ( const int& val ) { return val * 3 + 1; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto val : vec )
+         {
+            if ( pred( val ) ) sum += map( val );
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, hand-written loop", ms, vec.size() );
+
+#ifdef __cpp_lib_ranges
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto val : vec | std::views::filter( pred ) | std::views::transform( map ) )
+         {
+            sum += val;
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, std::ranges", ms, vec.size() );
+#endif
+
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto val : Lazy::MakeLazy( vec ).Filter( Lazy::_Pred<int>( pred ) ).Map( Lazy::_Map<int, int>( map ) ) )
+         {
+            sum += val;
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, Lazy with std::function", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto val : Lazy::MakeLazy( vec ).Filter( pred ).Map( map ) )
+         {
+            sum += val;
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, Lazy with concrete callables", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).ForEach( [&sum] ( int val ) { sum += val; } );
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, Lazy ForEach (push)", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         auto range = Lazy::MakeLazy( vec ).Filter( pred ).Map( map );
+         int batch[256];
+         auto cur = std::begin( range );
+         auto end = std::end( range );
+         while ( size_t read = Lazy::NextBatch( cur, end, batch, 256 ) )
+         {
+            for ( size_t i = 0; i < read; i++ ) sum += batch[i];
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, Lazy NextBatch (pull)", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Filter( Lazy::_Pred<int>( pred ) ).Map( Lazy::_Map<int, int>( map ) ).ToVector();
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+Map+ToVector, Lazy with std::function", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).ToVector();
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+Map+ToVector, Lazy with concrete callables", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         std::vector<int> result;
+         for ( auto val : vec )
+         {
+            if ( pred( val ) ) result.push_back( map( val ) );
+         }
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+Map+ToVector, hand-written loop", ms, vec.size() );
+
+#ifdef __cpp_lib_ranges
+      ms = Bench::Measure( [&] ()
+      {
+         std::vector<int> result;
+         for ( auto val : vec | std::views::filter( pred ) | std::views::transform( map ) )
+         {
+            result.push_back( val );
+         }
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+Map+ToVector, std::ranges", ms, vec.size() );
+#endif
+   }
+
+   void BenchIteration( const std::vector<int>& vec )
+   {
+      //Iterator loops, e.g. from std algorithms. The end check of each dereference compares against the
+      //iterator's own end, which the loop condition does not always prove, so it may stay in the loop. Compare
+      //with ThinkingCode_Bench_Checked
+      auto map = [] ( const int& val ) { return val * 3 + 1; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto val : vec ) sum += map( val );
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Map+Sum, hand-written loop", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto val : Lazy::MakeLazy( vec ).Map( map ) ) sum += val;
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Map+Sum, Lazy iterators", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto range = Lazy::MakeLazy( vec ).Map( map ).Limit( vec.size() / 2 );
+         Bench::Consume( std::accumulate( range.begin(), range.end(), 0ll ) );
+      } );
+      Bench::Report( "Map+Limit+Sum, std::accumulate", ms, vec.size() / 2 );
+   }
+
+   void BenchParallel( const std::vector<int>& vec )
+   {
+      //Something that is CPU bound, so that the benchmark does not only measure the memory bandwidth
+      auto expensive = [] ( const int& val )
+      {
+         unsigned hash = static_cast<unsigned>( val );
+         for ( int i = 0; i < 16; i++ ) hash = hash * 2654435761u + 0x9e3779b9u;
+         return hash;
+      };
+      auto pred = [] ( const unsigned& val ) { return ( val & 1 ) != 0; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Map( expensive ).Filter( pred ).ToVector();
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Map+Filter+ToVector, sequential", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Map( expensive ).Filter( pred ).ToVector( Lazy::Parallel() );
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Map+Filter+ToVector, parallel", ms, vec.size() );
+
+      //A filter directly over the source is evaluated into a bitmask and compacted into the result
+      auto selective = [&expensive] ( const int& val ) { return ( expensive( val ) & 1 ) != 0; };
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Filter( selective ).ToVector();
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+ToVector, sequential", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Filter( selective ).ToVector( Lazy::Parallel() );
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+ToVector, parallel", ms, vec.size() );
+   }
+
+   void BenchPrepared( const std::vector<int>& vec )
+   {
+      //Many small inputs, e.g. one per request, each run through the same chain of type erased functions.
+      //The captures are too large for the small buffer of std::function, so each copy allocates
+      std::vector<std::vector<int>> batches;
+      for ( size_t i = 0; i + 16 <= vec.size(); i += 16 ) batches.emplace_back( vec.begin() + i, vec.begin() + i + 16 );
+
+      int bounds[8] = { 100, 900, 3, 7 };
+      Lazy::_Pred<int> pred = [bounds] ( const int& val ) { return val > bounds[0] && val < bounds[1]; };
+      Lazy::_Map<int, int> map = [bounds] ( const int& val ) { return val * bounds[2] + bounds[3]; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         int sum = 0;
+         for ( const auto& batch : batches ) sum += Lazy::MakeLazy( batch ).Filter( pred ).Map( map ).Sum();
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Batches of 16, chain built per batch", ms, batches.size() * 16 );
+
+      auto pipeline = Lazy::Prepare<std::vector<int>>().Filter( pred ).Map( map );
+      ms = Bench::Measure( [&] ()
+      {
+         int sum = 0;
+         for ( const auto& batch : batches ) sum += pipeline.Bind( batch ).Sum();
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Batches of 16, prepared pipeline", ms, batches.size() * 16 );
+   }
+
+   void BenchPipelined( const std::vector<int>& vec )
+   {
+      //Three CPU bound stages, e.g. decode, transform and encode. Pipelining needs a core per stage to pay off
+      auto stage = [] ( const unsigned& val )
+      {
+         unsigned hash = val;
+         for ( int i = 0; i < 16; i++ )
+         {
+            hash ^= hash >> 15;
+            hash *= 0x2c1b3c6du;
+         }
+         return hash;
+      };
+      std::vector<unsigned> input( vec.begin(), vec.begin() + vec.size() / 8 );
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( input ).Map( stage ).Map( stage ).Map( stage ).Sum() );
+      } );
+      Bench::Report( "Map x3+Sum, sequential", ms, input.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( input ).Map( stage ).Pipelined().Map( stage ).Pipelined().Map( stage ).Sum() );
+      } );
+      Bench::Report( "Map x3+Sum, pipelined", ms, input.size() );
+   }
+
+   void BenchVectorized( const std::vector<int>& vec )
+   {
+      auto pred = [] ( const int& val ) { return val < 500; };
+      auto map = [] ( const int& val ) { return val * 0.25f; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).ToVector();
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+Map+ToVector, element-wise", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto result = Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).ToVector( Lazy::Vectorized() );
+         Bench::Consume( result.size() );
+      } );
+      Bench::Report( "Filter+Map+ToVector, vectorized", ms, vec.size() );
+   }
+
+   void BenchReductions( const std::vector<int>& vec )
+   {
+      auto pred = [] ( const int& val ) { return ( val & 3 ) != 0; };
+      auto map = [] ( const int& val ) { return static_cast<long long>( val ); };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         auto values = Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).ToVector();
+         long long sum = 0;
+         for ( auto val : values ) sum += val;
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Filter+Map, ToVector and sum", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).Sum() );
+      } );
+      Bench::Report( "Filter+Map, Sum", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).Filter( pred ).Map( map ).Sum( Lazy::Parallel() ) );
+      } );
+      Bench::Report( "Filter+Map, parallel Sum", ms, vec.size() );
+   }
+
+   void BenchWindows( const std::vector<int>& vec )
+   {
+      const size_t windowSize = 8;
+      auto sum = [] ( const Lazy::BufferView<int>& view )
+      {
+         long long sum = 0;
+         for ( auto val : view ) sum += val;
+         return sum;
+      };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         long long total = 0;
+         for ( size_t i = 0; i + windowSize <= vec.size(); i++ )
+         {
+            long long sum = 0;
+            for ( size_t j = 0; j < windowSize; j++ ) sum += vec[i + j];
+            total += sum;
+         }
+         Bench::Consume( total );
+      } );
+      Bench::Report( "Window(8) sums, hand-written loop", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).Window( windowSize ).Map( sum ).Sum() );
+      } );
+      Bench::Report( "Window(8) sums, Lazy", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).Chunk( windowSize ).Map( sum ).Sum() );
+      } );
+      Bench::Report( "Chunk(8) sums, Lazy", ms, vec.size() );
+   }
+
+   void BenchGrouping( const std::vector<int>& vec )
+   {
+      auto key = [] ( const int& val ) { return val % 97; };
+      auto plus = [] ( long long acc, long long val ) { return acc + val; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         auto values = Lazy::MakeLazy( vec ).ToVector();
+         std::sort( values.begin(), values.end(), [&key] ( int l, int r ) { return key( l ) < key( r ); } );
+         size_t groups = 0;
+         long long sum = 0;
+         for ( size_t i = 0; i < values.size(); i++ )
+         {
+            if ( i == 0 || key( values[i] ) != key( values[i - 1] ) ) groups++;
+            sum += values[i];
+         }
+         Bench::Consume( groups + sum );
+      } );
+      Bench::Report( "Sum by key, ToVector+sort+scan", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).AggregateBy( key, 0LL, plus ).size() );
+      } );
+      Bench::Report( "Sum by key, AggregateBy", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).AggregateBy( key, 0LL, plus, Lazy::Parallel() ).size() );
+      } );
+      Bench::Report( "Sum by key, parallel AggregateBy", ms, vec.size() );
+   }
+
+   void BenchDistinct( const std::vector<int>& vec )
+   {
+      //Mostly unique keys, where a Bloom filter in front of the set skips most key comparisons
+      std::vector<unsigned> unique;
+      unique.reserve( vec.size() / 8 );
+      for ( size_t i = 0; i < vec.size() / 8; i++ ) unique.push_back( static_cast<unsigned>( i * 2654435761u ) % 0x7fffffffu );
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         auto values = unique;
+         std::sort( values.begin(), values.end() );
+         Bench::Consume( std::unique( values.begin(), values.end() ) - values.begin() );
+      } );
+      Bench::Report( "Distinct mostly unique, sort+unique", ms, unique.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( unique ).Distinct().Count() );
+      } );
+      Bench::Report( "Distinct mostly unique, Distinct", ms, unique.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( unique ).Distinct( Lazy::BloomPrefilter( unique.size() ) ).Count() );
+      } );
+      Bench::Report( "Distinct mostly unique, Distinct+Bloom", ms, unique.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).Distinct().Count() );
+      } );
+      Bench::Report( "Distinct 1000 keys, Distinct", ms, vec.size() );
+   }
+
+   void BenchSketches( const std::vector<int>& vec )
+   {
+      std::vector<unsigned> values;
+      values.reserve( vec.size() );
+      for ( size_t i = 0; i < vec.size(); i++ ) values.push_back( static_cast<unsigned>( i * 2654435761u ) % ( vec.size() / 4 ) );
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( values ).Distinct().Count() );
+      } );
+      Bench::Report( "Count distinct, Distinct+Count", ms, values.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( values ).CountDistinctApprox() );
+      } );
+      Bench::Report( "Count distinct, CountDistinctApprox", ms, values.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( values ).CountDistinctApprox( Lazy::Parallel() ) );
+      } );
+      Bench::Report( "Count distinct, CountDistinctApprox parallel", ms, values.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         auto sorted = Lazy::MakeLazy( values ).ToVector();
+         auto p99 = sorted.begin() + sorted.size() * 99 / 100;
+         std::nth_element( sorted.begin(), p99, sorted.end() );
+         Bench::Consume( *p99 );
+      } );
+      Bench::Report( "p99, ToVector+nth_element", ms, values.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( values ).QuantilesApprox().Quantile( 0.99 ) );
+      } );
+      Bench::Report( "p99, QuantilesApprox", ms, values.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( values ).QuantilesApprox( Lazy::Parallel() ).Quantile( 0.99 ) );
+      } );
+      Bench::Report( "p99, QuantilesApprox parallel", ms, values.size() );
+   }
+
+   void BenchOrderBy( const std::vector<int>& vec )
+   {
+      auto key = [] ( const int& val ) { return static_cast<unsigned>( val ) * 2654435761u; };
+
+      auto ms = Bench::Measure( [&] ()
+      {
+         auto values = Lazy::MakeLazy( vec ).ToVector();
+         std::sort( values.begin(), values.end(), [&key] ( int l, int r ) { return key( l ) < key( r ); } );
+         values.resize( 10 );
+         Bench::Consume( values.back() );
+      } );
+      Bench::Report( "Top 10 by key, ToVector+sort", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).OrderBy( key ).Limit( 10 ).ToVector().back() );
+      } );
+      Bench::Report( "Top 10 by key, OrderBy+Limit", ms, vec.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         Bench::Consume( Lazy::MakeLazy( vec ).OrderBy( key ).ToVector().back() );
+      } );
+      Bench::Report( "Sort by key, OrderBy", ms, vec.size() );
+   }
+
+}
+
+void RunLazyBenchmarks( size_t elementCount )
+{
+   std::vector<int> vec;
+   vec.reserve( elementCount );
+   for ( size_t i = 0; i < elementCount; i++ ) vec.push_back( static_cast<int>( i % 1000 ) );
+
+   printf( "Lazy (%llu elements, %s iteration)\n", static_cast<unsigned long long>( elementCount ),
+           Lazy::CheckedIteration ? "checked" : "unchecked" );
+   BenchCallables( vec );
+   BenchIteration( vec );
+   BenchParallel( vec );
+   BenchPipelined( vec );
+   BenchPrepared( vec );
+   BenchVectorized( vec );
+   BenchReductions( vec );
+   BenchWindows( vec );
+   BenchGrouping( vec );
+   BenchDistinct( vec );
+   BenchSketches( vec );
+   BenchOrderBy( vec );
+}
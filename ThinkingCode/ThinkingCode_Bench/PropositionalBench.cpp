@@ -0,0 +1,82 @@
+#include "Benchmark.h"
+#include "Propositional.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+   //! \brief Checks the validity of an expression repeatedly
+   //!
+   //! The expressions don't depend on any input, so an optimizing compiler evaluates the whole check at compile
+   //! time. Calling it through a volatile function pointer keeps the loop, so this measures whether that is
+   //! still the case: a check that is not folded anymore takes a lot longer than a call
+   //! \param name Name of the benchmark
+   //! \param checks Number of validity checks
+   template<typename _Check>
+   void BenchCheck( const char* name, _Check check, size_t checks )
+   {
+      Validity( *volatile fn )( ) = check;
+      auto ms = Bench::Measure( [&] ()
+      {
+         size_t always = 0;
+         for ( size_t i = 0; i < checks; i++ )
+         {
+            if ( fn() == Validity::Always ) always++;
+         }
+         Bench::Consume( always );
+      } );
+      Bench::Report( name, ms, checks );
+   }
+
+   //! \brief Evaluates an expression for assignments of its variables that are only known at runtime, which
+   //!        is what CheckValidity does for each of the 2^N assignments of N variables
+   //! \param name Name of the benchmark
+   //! \param assignments One assignment per element, bit i is the value of the i-th variable
+   //! \param eval Evaluates the expression for an assignment
+   template<typename _Eval>
+   void BenchEvaluate( const char* name, const std::vector<uint8_t>& assignments, _Eval eval )
+   {
+      auto ms = Bench::Measure( [&] ()
+      {
+         size_t trueCount = 0;
+         for ( auto bits : assignments )
+         {
+            if ( eval( bits ) ) trueCount++;
+         }
+         Bench::Consume( trueCount );
+      } );
+      Bench::Report( name, ms, assignments.size() );
+   }
+
+}
+
+void RunPropositionalBenchmarks( size_t elementCount )
+{
+   //Each check evaluates the expression for all 2^N assignments of its N variables. The expressions are
+   //tautologies, so no check stops early
+   size_t checks = std::max( elementCount / 16, size_t( 1 ) );
+
+   printf( "Propositional (%llu checks)\n", static_cast<unsigned long long>( checks ) );
+   BenchCheck( "CheckValidity, 1 variable", &CheckValidity<Or<A, Not<A>>, A>, checks );
+   BenchCheck( "CheckValidity, 2 variables", &CheckValidity<Equals<Implies<A, B>, Or<Not<A>, B>>, A, B>, checks );
+   BenchCheck( "CheckValidity, 3 variables", &CheckValidity<Implies<And<Implies<A, B>, Implies<B, C>>, Implies<A, C>>, A, B, C>, checks );
+
+   std::vector<uint8_t> assignments( checks );
+   for ( size_t i = 0; i < checks; i++ ) assignments[i] = static_cast<uint8_t>( ( i * 2654435761u ) >> 13 );
+
+   BenchEvaluate( "Evaluate expression, 1 variable", assignments, [] ( uint8_t bits )
+   {
+      return BuildExpr<Not<A>, A>::Build( ( bits & 1 ) != 0 )();
+   } );
+   BenchEvaluate( "Evaluate expression, 2 variables", assignments, [] ( uint8_t bits )
+   {
+      return BuildExpr<Implies<A, B>, A, B>::Build( ( bits & 1 ) != 0, ( bits & 2 ) != 0 )();
+   } );
+   BenchEvaluate( "Evaluate expression, 3 variables", assignments, [] ( uint8_t bits )
+   {
+      return BuildExpr<And<Implies<A, B>, Or<B, Not<C>>>, A, B, C>::Build( ( bits & 1 ) != 0, ( bits & 2 ) != 0, ( bits & 4 ) != 0 )();
+   } );
+}
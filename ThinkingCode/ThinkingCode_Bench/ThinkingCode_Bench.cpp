@@ -0,0 +1,48 @@
+// ThinkingCode_Bench.cpp : Benchmarks for the code examples.
+//
+// Usage: ThinkingCode_Bench [elementCount]
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+void RunLazyBenchmarks( size_t elementCount );
+void RunZipBenchmarks( size_t elementCount );
+void RunPropositionalBenchmarks( size_t elementCount );
+
+std::atomic<uint64_t> Bench::allocationCount( 0 );
+
+//Replacing the global allocation functions counts every heap allocation of the benchmarks, including those
+//of the standard containers. The array and nothrow versions call these by default
+
+void* operator new( size_t size )
+{
+   Bench::allocationCount.fetch_add( 1, std::memory_order_relaxed );
+   if ( void* ptr = malloc( size ? size : 1 ) ) return ptr;
+   throw std::bad_alloc();
+}
+
+void operator delete( void* ptr ) noexcept
+{
+   free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+   free( ptr );
+}
+
+int main( int argc, char* argv[] )
+{
+   size_t elementCount = 100000000;
+   if ( argc > 1 ) elementCount = static_cast<size_t>( strtoull( argv[1], nullptr, 10 ) );
+
+   Bench::PrintHeader();
+   RunLazyBenchmarks( elementCount );
+   RunZipBenchmarks( elementCount );
+   RunPropositionalBenchmarks( elementCount );
+
+   return 0;
+}
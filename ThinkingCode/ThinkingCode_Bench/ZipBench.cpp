@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+#include "ZipIterator.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+   void BenchTwoRanges( const std::vector<int>& first, const std::vector<int>& second )
+   {
+      auto ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( size_t i = 0; i < first.size() && i < second.size(); i++ )
+         {
+            sum += static_cast<long long>( first[i] ) * second[i];
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Dot product, index loop", ms, first.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         long long sum = 0;
+         for ( auto elements : Zip::Zip( first, second ) )
+         {
+            sum += static_cast<long long>( std::get<0>( elements ) ) * std::get<1>( elements );
+         }
+         Bench::Consume( sum );
+      } );
+      Bench::Report( "Dot product, Zip", ms, first.size() );
+   }
+
+   void BenchThreeRanges( const std::vector<int>& first, const std::vector<int>& second, std::vector<int>& out )
+   {
+      auto ms = Bench::Measure( [&] ()
+      {
+         for ( size_t i = 0; i < first.size() && i < second.size() && i < out.size(); i++ )
+         {
+            out[i] = first[i] * 3 + second[i];
+         }
+         Bench::Consume( out.back() );
+      } );
+      Bench::Report( "Fused multiply-add into output, index loop", ms, first.size() );
+
+      ms = Bench::Measure( [&] ()
+      {
+         for ( auto elements : Zip::Zip( first, second, out ) )
+         {
+            std::get<2>( elements ) = std::get<0>( elements ) * 3 + std::get<1>( elements );
+         }
+         Bench::Consume( out.back() );
+      } );
+      Bench::Report( "Fused multiply-add into output, Zip", ms, first.size() );
+   }
+
+}
+
+void RunZipBenchmarks( size_t elementCount )
+{
+   //Three ranges of the full element count would need three times the memory of the Lazy benchmarks
+   size_t count = std::max( elementCount / 4, size_t( 1 ) );
+   std::vector<int> first, second, out( count );
+   first.reserve( count );
+   second.reserve( count );
+   for ( size_t i = 0; i < count; i++ )
+   {
+      first.push_back( static_cast<int>( i % 1000 ) );
+      second.push_back( static_cast<int>( i % 7 ) );
+   }
+
+   printf( "Zip (%llu elements)\n", static_cast<unsigned long long>( count ) );
+   BenchTwoRanges( first, second );
+   BenchThreeRanges( first, second, out );
+}
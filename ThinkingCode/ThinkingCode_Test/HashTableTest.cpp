@@ -0,0 +1,104 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "HashTable.h"
+
+#include <memory>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ThinkingCode_Test
+{
+	TEST_CLASS(HashTableTest)
+	{
+	public:
+
+      TEST_METHOD( TestArena )
+      {
+         Containers::Arena<std::string> arena;
+         Assert::IsTrue( arena.begin() == arena.end(), L"Empty arena must not have elements!" );
+
+         std::vector<const std::string*> pointers;
+         for ( int i = 0; i < 10000; i++ ) pointers.push_back( &arena.Emplace( std::to_string( i ) ) );
+         Assert::IsTrue( arena.size() == 10000, L"Wrong number of elements!" );
+
+         int idx = 0;
+         for ( auto& element : arena )
+         {
+            Assert::IsTrue( &element == pointers[idx] && element == std::to_string( idx ), L"Elements must not move!" );
+            idx++;
+         }
+         Assert::IsTrue( idx == 10000, L"Wrong number of iterated elements!" );
+
+         auto shared = std::make_shared<int>( 1 );
+         {
+            Containers::Arena<std::shared_ptr<int>> owners;
+            owners.Emplace( shared );
+            Assert::IsTrue( shared.use_count() == 2, L"Element not created!" );
+         }
+         Assert::IsTrue( shared.use_count() == 1, L"Elements not destroyed!" );
+      }
+
+      TEST_METHOD( TestHashTable )
+      {
+         Containers::HashTable<int, int> table;
+         Assert::IsTrue( table.empty() && !table.Find( 1 ), L"Empty table must not have entries!" );
+
+         //Multiples of a power of two collide without mixing the hash
+         for ( int i = 0; i < 5000; i++ ) table.FindOrInsert( i * 1024, 0 ) += i;
+         for ( int i = 0; i < 5000; i++ ) table.FindOrInsert( i * 1024, 0 ) += 1;
+         Assert::IsTrue( table.size() == 5000, L"Wrong number of entries!" );
+         Assert::IsTrue( *table.Find( 1024 * 42 ) == 43, L"Wrong value!" );
+         Assert::IsFalse( table.Contains( 1 ), L"Key must not exist!" );
+
+         int idx = 0;
+         for ( auto& entry : table )
+         {
+            Assert::IsTrue( entry.first == idx * 1024 && entry.second == idx + 1, L"Entries must be in insertion order!" );
+            idx++;
+         }
+
+         Containers::HashTable<std::string, int> left, right;
+         left.FindOrInsert( "a", 1 );
+         left.FindOrInsert( "b", 2 );
+         right.FindOrInsert( "b", 3 );
+         right.FindOrInsert( "c", 4 );
+         left.Merge( std::move( right ), [] ( int& val, int&& other ) { val += other; } );
+         Assert::IsTrue( left.size() == 3 && right.empty(), L"Merge moves all entries!" );
+         Assert::IsTrue( *left.Find( "a" ) == 1 && *left.Find( "b" ) == 5 && *left.Find( "c" ) == 4, L"Merge not working!" );
+      }
+
+      TEST_METHOD( TestHashSet )
+      {
+         Containers::HashSet<int> set;
+         Assert::IsTrue( set.empty() && !set.Contains( 0 ), L"Empty set must not have keys!" );
+
+         //Multiples of a power of two collide without mixing the hash
+         for ( int i = 0; i < 5000; i++ ) Assert::IsTrue( set.Insert( i * 1024 ), L"New key not inserted!" );
+         for ( int i = 0; i < 5000; i++ ) Assert::IsFalse( set.Insert( i * 1024 ), L"Existing key inserted again!" );
+         Assert::IsTrue( set.size() == 5000 && set.Contains( 1024 * 42 ) && !set.Contains( 1 ), L"Wrong keys!" );
+
+         Containers::HashSet<std::string> strings;
+         strings.InsertNew( "a", strings.Hash( "a" ) );
+         Assert::IsTrue( strings.Insert( "b" ) && !strings.Insert( "a" ) && strings.size() == 2, L"InsertNew not working!" );
+      }
+
+      TEST_METHOD( TestBloomFilter )
+      {
+         Containers::HashSet<int> set;
+         Containers::BloomFilter filter( 10000, 0.01 );
+         for ( int i = 0; i < 10000; i++ ) filter.Add( set.Hash( i ) );
+
+         bool allFound = true;
+         for ( int i = 0; i < 10000; i++ ) allFound = allFound && filter.MayContain( set.Hash( i ) );
+         Assert::IsTrue( allFound, L"Bloom filter must not have false negatives!" );
+
+         int falsePositives = 0;
+         for ( int i = 10000; i < 110000; i++ ) falsePositives += filter.MayContain( set.Hash( i ) ) ? 1 : 0;
+         Assert::IsTrue( falsePositives < 3000, L"Too many false positives!" );
+
+         Assert::ExpectException<std::exception>( [] () { Containers::BloomFilter( 100, 0.0 ); }, L"False positive rate of zero must throw!" );
+         Assert::ExpectException<std::exception>( [] () { Containers::BloomFilter( 100, 1.0 ); }, L"False positive rate of one must throw!" );
+      }
+	};
+}
@@ -0,0 +1,112 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "LazyCoroutine.h"
+
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+   Lazy::Generator<int> Naturals()
+   {
+      for ( int i = 0; ; i++ ) co_yield i;
+   }
+
+   Lazy::Generator<std::string> Words( int count, bool fail )
+   {
+      for ( int i = 0; i < count; i++ ) co_yield std::to_string( i );
+      if ( fail ) throw std::runtime_error( "Generator failed!" );
+   }
+
+   //! \brief Coroutine that starts immediately and is not awaited by anyone
+   struct _Task
+   {
+      struct promise_type
+      {
+         _Task get_return_object() { return {}; }
+         std::suspend_never initial_suspend() noexcept { return {}; }
+         std::suspend_never final_suspend() noexcept { return {}; }
+         void return_void() {}
+         void unhandled_exception() { std::terminate(); }
+      };
+   };
+}
+
+namespace ThinkingCode_Test
+{
+	TEST_CLASS(LazyCoroutineTest)
+	{
+	public:
+
+      TEST_METHOD( TestGenerator )
+      {
+         //Infinite generator with limit
+         auto squares = Lazy::MakeLazy( Naturals() )
+            .Map( [] ( const int& val ) { return val * val; } )
+            .Limit( 5 )
+            .ToVector();
+         Assert::IsTrue( squares == std::vector<int>{ 0, 1, 4, 9, 16 }, L"Generator with limit not working!" );
+
+         auto words = Words( 3, false );
+         auto joined = Lazy::MakeLazy( words ).Fold( std::string(), [] ( std::string acc, const std::string& word ) { return acc + word; } );
+         Assert::IsTrue( joined == "012", L"Generator of lvalue not working!" );
+
+         auto empty = Lazy::MakeLazy( Words( 0, false ) ).ToVector();
+         Assert::IsTrue( empty.empty(), L"Empty generator not working!" );
+
+         try
+         {
+            Lazy::MakeLazy( Words( 2, true ) ).ToVector();
+            Assert::Fail( L"Exception of generator not rethrown!" );
+         }
+         catch ( const std::exception& )
+         {
+         }
+      }
+
+      TEST_METHOD( TestAsyncTerminals )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 1000; i++ ) vec.push_back( i );
+         auto even = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 2 == 0; } );
+
+         for ( size_t threads : { size_t( 0 ), size_t( 2 ) } )
+         {
+            Threading::ThreadPool pool( threads );
+            std::promise<void> finished;
+            std::vector<int> result;
+            int sum = 0, count = 0;
+            std::string error;
+
+            //The captures live in the lambda, so it has to outlive the coroutine
+            auto run = [&] () -> _Task
+            {
+               result = co_await Lazy::ToVectorAsync( even, &pool );
+               sum = co_await Lazy::FoldAsync( even, 0, [] ( int acc, const int& val ) { return acc + val; }, &pool );
+               co_await Lazy::ForEachAsync( even, [&count] ( const int& ) { count++; }, &pool );
+               try
+               {
+                  co_await Lazy::Async( even, [] ( const auto& ) -> int { throw std::runtime_error( "Terminal failed!" ); }, &pool );
+               }
+               catch ( const std::exception& e )
+               {
+                  error = e.what();
+               }
+               finished.set_value();
+            };
+            run();
+
+            finished.get_future().wait();
+            Assert::IsTrue( result.size() == 500 && result[1] == 2, L"ToVectorAsync not working!" );
+            Assert::IsTrue( sum == 249500, L"FoldAsync not working!" );
+            Assert::IsTrue( count == 500, L"ForEachAsync not working!" );
+            Assert::IsTrue( error == "Terminal failed!", L"Exception of terminal not rethrown!" );
+         }
+      }
+	};
+}
@@ -1,9 +1,47 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 #include "Lazy.h"
+#include "LazyFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+namespace
+{
+   //! \brief Even number predicate that counts its copies, to check that operations don't copy their functions
+   struct CountingPred
+   {
+      CountingPred( int* copies ) :
+         copies( copies )
+      {
+      }
+
+      CountingPred( const CountingPred& other ) :
+         copies( other.copies )
+      {
+         ++*copies;
+      }
+
+      bool operator()( const int& val ) const
+      {
+         return val % 2 == 0;
+      }
+
+      int* copies;
+   };
+}
+
 namespace ThinkingCode_Test
 {		
 
@@ -118,7 +156,1084 @@ namespace ThinkingCode_Test
 
             Assert::IsTrue(limitHighVec.size() == vec.size(), L"Limit with size > range size not working!");
          }
+
+         //Only the limited elements are evaluated
+         {
+            std::vector<int> vec = {1,2,3,4,5,6,7,8,9};
+
+            size_t mapCalls = 0;
+            auto limited = Lazy::MakeLazy( vec ).Map( [&] ( const int& val ) { mapCalls++; return val; } ).Limit( 2 );
+
+            auto limitedVec = limited.ToVector();
+            Assert::IsTrue( limitedVec.size() == 2, L"Limit over map not working!" );
+            Assert::IsTrue( mapCalls == 2, L"Limit evaluates elements past the limit!" );
+
+            mapCalls = 0;
+            auto first = limited.First();
+            Assert::IsTrue( first && first.val == 1, L"First on limited range not working!" );
+            Assert::IsTrue( mapCalls == 1, L"First on limited range evaluates more than one element!" );
+
+            size_t predCalls = 0;
+            auto limitedFilter = Lazy::MakeLazy( vec ).Filter( [&] ( const int& val ) { predCalls++; return ( val & 1 ) != 0; } ).Limit( 2 );
+            auto limitedFilterVec = limitedFilter.ToVector();
+
+            Assert::IsTrue( limitedFilterVec.size() == 2, L"Limit over filter not working!" );
+            Assert::IsTrue( limitedFilterVec[1] == 3, L"Limit over filter returns wrong element!" );
+            Assert::IsTrue( predCalls == 3, L"Limit over filter evaluates elements past the limit!" );
+
+            auto limitZero = Lazy::MakeLazy( vec ).Limit( 0 ).ToVector();
+            Assert::IsTrue( limitZero.size() == 0, L"Limit of zero not working!" );
+         }
+      }
+
+      TEST_METHOD( TestConcreteCallables )
+      {
+         std::vector<int> vec = {1,2,3,4,5,6,7,8,9};
+
+         //Lambdas are stored with their concrete type
+         {
+            auto isOdd = [] ( const int& val ) { return ( val & 1 ) != 0; };
+            auto square = [] ( const int& val ) { return val * val; };
+
+            auto chain = Lazy::MakeLazy( vec ).Filter( isOdd ).Map( square );
+            auto chainVec = chain.ToVector();
+
+            using _Source = std::vector<int>::const_iterator;
+            using _Expected = Lazy::LazyMap<int, int, Lazy::LazyFilter<int, _Source, decltype( isOdd )>, decltype( square )>;
+            Assert::IsTrue( std::is_same<decltype( std::begin( chain ) ), _Expected>::value, L"Lambda is not stored with its concrete type!" );
+
+            Assert::IsTrue( chainVec.size() == 5, L"Filter with concrete predicate not working!" );
+            Assert::IsTrue( chainVec[0] == 1, L"Map with concrete function not working!" );
+            Assert::IsTrue( chainVec[1] == 9, L"Map with concrete function not working!" );
+            Assert::IsTrue( chainVec[4] == 81, L"Map with concrete function not working!" );
+
+            auto crossType = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return val * 0.5; } ).ToVector();
+            Assert::IsTrue( std::is_same<decltype( crossType ), std::vector<double>>::value, L"Destination type of map is not deduced!" );
+            Assert::IsTrue( crossType[1] == 1.0, L"Cross-type map with concrete function not working!" );
+         }
+
+         //Explicit std::function objects still take the type-erased path
+         {
+            Lazy::_Pred<int> isEven = [] ( const int& val ) { return ( val & 1 ) == 0; };
+            auto filtered = Lazy::MakeLazy( vec ).Filter( isEven );
+
+            using _Expected = Lazy::LazyFilter<int, std::vector<int>::const_iterator>;
+            Assert::IsTrue( std::is_same<decltype( std::begin( filtered ) ), _Expected>::value, L"std::function predicate is not type-erased!" );
+            Assert::IsTrue( filtered.ToVector().size() == 4, L"Filter with std::function not working!" );
+         }
+      }
+
+
+      TEST_METHOD( TestParallel )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 10000; i++ ) vec.push_back( i );
+
+         Threading::ThreadPool pool( 3 );
+         Lazy::Parallel policy( 16, &pool );
+
+         //Parallel ToVector keeps the order of the sequential evaluation
+         {
+            auto range = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 3 != 0; } ).Map( [] ( const int& val ) { return val * 2; } );
+
+            auto sequential = range.ToVector();
+            auto parallel = range.ToVector( policy );
+
+            Assert::IsTrue( sequential == parallel, L"Parallel ToVector does not match sequential ToVector!" );
+
+            auto empty = Lazy::MakeLazy( std::vector<int>() ).Map( [] ( const int& val ) { return val; } ).ToVector( policy );
+            Assert::IsTrue( empty.size() == 0, L"Parallel ToVector with empty range not working!" );
+
+            struct NoDefault
+            {
+               explicit NoDefault( int val ) : val( val ) {}
+
+               int val;
+            };
+            auto wrapped = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return NoDefault( val ); } ).ToVector( policy );
+            Assert::IsTrue( wrapped.size() == vec.size() && wrapped.back().val == 9999, L"Parallel ToVector without default constructor not working!" );
+         }
+
+         //Parallel ForEach visits every element exactly once
+         {
+            std::atomic<long long> sum( 0 );
+            std::atomic<size_t> count( 0 );
+            Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return ( val & 1 ) == 0; } ).ForEach( [&] ( int val )
+            {
+               sum += val;
+               count++;
+            }, policy );
+
+            Assert::IsTrue( count == vec.size() / 2, L"Parallel ForEach does not visit all elements!" );
+            Assert::IsTrue( sum == 24995000, L"Parallel ForEach visits wrong elements!" );
+         }
+
+         //Ranges that can't be split fall back to sequential evaluation
+         {
+            auto limited = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return val + 1; } ).Limit( 5 ).ToVector( policy );
+            Assert::IsTrue( limited.size() == 5 && limited[4] == 5, L"Parallel ToVector with limit not working!" );
+
+            std::list<int> list( vec.begin(), vec.begin() + 100 );
+            auto fromList = Lazy::MakeLazy( list ).Filter( [] ( const int& val ) { return val < 10; } ).ToVector( policy );
+            Assert::IsTrue( fromList.size() == 10 && fromList[9] == 9, L"Parallel ToVector with non random access source not working!" );
+         }
+      }
+
+      TEST_METHOD( TestSizeAndCategory )
+      {
+         std::vector<int> vec = {1,2,3,4,5,6,7,8,9};
+
+         //Map keeps random access
+         {
+            auto mapped = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return val * 2; } );
+
+            using _Category = std::iterator_traits<decltype( std::begin( mapped ) )>::iterator_category;
+            Assert::IsTrue( std::is_same<_Category, std::random_access_iterator_tag>::value, L"Map over vector is not random access!" );
+
+            auto begin = std::begin( mapped );
+            Assert::IsTrue( std::distance( begin, std::end( mapped ) ) == 9, L"Distance over map not working!" );
+            Assert::IsTrue( begin[3] == 8, L"Random access over map not working!" );
+            Assert::IsTrue( *( begin + 8 ) == 18, L"Random access over map not working!" );
+            Assert::IsTrue( *( 8 + begin ) == 18, L"Offset before map iterator not working!" );
+            Assert::IsTrue( std::is_same<std::iterator_traits<decltype( begin )>::reference, int>::value, L"Map must return its elements by value!" );
+            auto next = begin;
+            Assert::IsTrue( *next++ == 2 && *next == 4, L"Postfix increment over map not working!" );
+            Assert::IsTrue( *next-- == 4 && next == begin, L"Postfix decrement over map not working!" );
+            Assert::IsTrue( mapped.Size() == 9, L"Size of map not working!" );
+         }
+
+         //Filters only know an upper bound
+         {
+            auto filtered = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val > 4; } );
+            Assert::IsTrue( filtered.SizeHint() == 9, L"Size hint of filter not working!" );
+            Assert::IsFalse( decltype( std::begin( filtered ) )::_SizeKnown::value, L"Size of filter must not be known!" );
+
+            auto limited = filtered.Limit( 3 );
+            Assert::IsTrue( limited.SizeHint() == 3, L"Size hint of limit over filter not working!" );
+
+            auto limitedMap = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return val; } ).Limit( 20 );
+            Assert::IsTrue( limitedMap.Size() == 9, L"Size of limit larger than the range not working!" );
+            Assert::IsTrue( Lazy::MakeLazy( vec ).Limit( 4 ).Size() == 4, L"Size of limit not working!" );
+         }
+
+         //Other containers stay forward ranges
+         {
+            std::list<int> list( vec.begin(), vec.end() );
+            auto mapped = Lazy::MakeLazy( list ).Map( [] ( const int& val ) { return val; } );
+
+            using _Category = std::iterator_traits<decltype( std::begin( mapped ) )>::iterator_category;
+            Assert::IsTrue( std::is_same<_Category, std::forward_iterator_tag>::value, L"Map over list must be a forward iterator!" );
+            Assert::IsTrue( mapped.SizeHint() == 9, L"Size hint of map over list not working!" );
+            Assert::IsTrue( mapped.ToVector().size() == 9, L"Map over list not working!" );
+         }
+      }
+
+      TEST_METHOD( TestVectorized )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 1000; i++ ) vec.push_back( i );
+
+         //Blocked evaluation gives the same result as element-wise evaluation
+         {
+            auto range = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 3 != 0; } )
+                                              .Map( [] ( const int& val ) { return val * 0.5; } )
+                                              .Filter( [] ( const double& val ) { return val < 400; } );
+            Assert::IsTrue( decltype( std::begin( range ) )::_Vectorizable::value, L"Arithmetic range over vector must be vectorizable!" );
+
+            auto blocked = range.ToVector( Lazy::Vectorized() );
+            Assert::IsTrue( blocked == range.ToVector(), L"Vectorized ToVector does not match sequential ToVector!" );
+
+            auto mapped = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return val + 1; } ).ToVector( Lazy::Vectorized() );
+            Assert::IsTrue( mapped.size() == vec.size() && mapped[999] == 1000, L"Vectorized map not working!" );
+
+            auto empty = Lazy::MakeLazy( std::vector<float>() ).Map( [] ( const float& val ) { return val; } ).ToVector( Lazy::Vectorized() );
+            Assert::IsTrue( empty.size() == 0, L"Vectorized ToVector with empty range not working!" );
+         }
+
+         //Everything else falls back to element-wise evaluation
+         {
+            auto limited = Lazy::MakeLazy( vec ).Limit( 10 );
+            Assert::IsFalse( decltype( std::begin( limited ) )::_Vectorizable::value, L"Limit must not be vectorizable!" );
+            Assert::IsTrue( limited.ToVector( Lazy::Vectorized() ).size() == 10, L"Vectorized ToVector with limit not working!" );
+
+            std::list<int> list( vec.begin(), vec.end() );
+            auto fromList = Lazy::MakeLazy( list ).Filter( [] ( const int& val ) { return val < 10; } ).ToVector( Lazy::Vectorized() );
+            Assert::IsTrue( fromList.size() == 10, L"Vectorized ToVector with non contiguous source not working!" );
+         }
+      }
+
+      TEST_METHOD( TestPush )
+      {
+         std::vector<int> vec = {1,2,3,4,5,6,7,8,9};
+
+         //Terminal operations stop the source once the result is known
+         {
+            size_t mapCalls = 0;
+            auto range = Lazy::MakeLazy( vec ).Map( [&] ( const int& val ) { mapCalls++; return val; } )
+                                              .Filter( [] ( const int& val ) { return ( val & 1 ) == 0; } );
+
+            auto first = range.First();
+            Assert::IsTrue( first && first.val == 2, L"First with push evaluation not working!" );
+            Assert::IsTrue( mapCalls == 2, L"First does not stop the source!" );
+
+            mapCalls = 0;
+            auto limited = range.Limit( 2 ).ToVector();
+            Assert::IsTrue( limited.size() == 2 && limited[0] == 2 && limited[1] == 4, L"Limit with push evaluation not working!" );
+            Assert::IsTrue( mapCalls == 4, L"Limit does not stop the source!" );
+
+            auto none = range.Filter( [] ( const int& val ) { return val > 100; } ).First();
+            Assert::IsFalse( none, L"First of empty range must not exist!" );
+         }
+
+         //Push and pull evaluation give the same elements
+         {
+            auto range = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val > 2; } )
+                                              .Limit( 5 )
+                                              .Map( [] ( const int& val ) { return val * 10; } )
+                                              .Limit( 3 );
+
+            std::vector<int> pulled;
+            for ( auto val : range ) pulled.push_back( val );
+
+            std::vector<int> pushed;
+            range.ForEach( [&] ( int val ) { pushed.push_back( val ); } );
+
+            Assert::IsTrue( pulled == pushed, L"Push and pull evaluation differ!" );
+            Assert::IsTrue( pushed == range.ToVector(), L"Push and pull evaluation differ!" );
+            Assert::IsTrue( pushed.size() == 3 && pushed[2] == 50, L"Push evaluation returns wrong elements!" );
+         }
+      }
+
+      TEST_METHOD( TestReductions )
+      {
+         std::vector<int> vec = {5,3,8,1,9,2,7,4,6};
+
+         //Sequential
+         {
+            auto range = Lazy::MakeLazy( vec );
+            Assert::IsTrue( range.Sum() == 45, L"Sum not working!" );
+            Assert::IsTrue( range.Count() == 9, L"Count not working!" );
+            Assert::IsTrue( range.Min().val == 1, L"Min not working!" );
+            Assert::IsTrue( range.Max().val == 9, L"Max not working!" );
+            Assert::IsTrue( range.Fold( std::string(), [] ( const std::string& acc, const int& val ) { return acc + std::to_string( val ); } ) == "538192746", L"Fold not working!" );
+            auto appended = range.Fold( std::string(), [] ( std::string&& acc, const int& val ) { acc += std::to_string( val ); return std::move( acc ); } );
+            Assert::IsTrue( appended == "538192746", L"Fold must move the accumulator!" );
+
+            //Counts its copies, to check that Min only copies an element that is smaller than the current minimum
+            struct Counted
+            {
+               Counted() : val( 0 ), copies( nullptr ) {}
+               Counted( int val, int* copies ) : val( val ), copies( copies ) {}
+               Counted( const Counted& other ) : val( other.val ), copies( other.copies ) { if ( copies ) ++*copies; }
+               Counted& operator=( const Counted& other ) { val = other.val; copies = other.copies; if ( copies ) ++*copies; return *this; }
+               bool operator<( const Counted& other ) const { return val < other.val; }
+
+               int val;
+               int* copies;
+            };
+            int copies = 0;
+            std::vector<Counted> ascending;
+            for ( int i = 0; i < 100; i++ ) ascending.push_back( Counted( i, &copies ) );
+            copies = 0;
+            Assert::IsTrue( Lazy::MakeLazy( ascending ).Min().val.val == 0, L"Min not working!" );
+            Assert::IsTrue( copies <= 3, L"Min copies the current minimum for each element!" );
+
+            auto odd = range.Filter( [] ( const int& val ) { return ( val & 1 ) != 0; } );
+            Assert::IsTrue( odd.Count() == 5, L"Count over filter not working!" );
+            Assert::IsTrue( odd.Sum() == 25, L"Sum over filter not working!" );
+
+            auto empty = range.Filter( [] ( const int& ) { return false; } );
+            Assert::IsTrue( empty.Sum() == 0 && empty.Count() == 0, L"Reductions over empty range not working!" );
+            Assert::IsFalse( empty.Min(), L"Min of empty range must not exist!" );
+            Assert::IsFalse( empty.Max(), L"Max of empty range must not exist!" );
+         }
+
+         //Any and All stop at the first element that decides the result
+         {
+            size_t calls = 0;
+            auto range = Lazy::MakeLazy( vec ).Map( [&] ( const int& val ) { calls++; return val; } );
+
+            Assert::IsTrue( range.Any( [] ( const int& val ) { return val == 8; } ), L"Any not working!" );
+            Assert::IsTrue( calls == 3, L"Any does not short-circuit!" );
+
+            calls = 0;
+            Assert::IsFalse( range.All( [] ( const int& val ) { return val > 2; } ), L"All not working!" );
+            Assert::IsTrue( calls == 4, L"All does not short-circuit!" );
+
+            Assert::IsFalse( range.Any( [] ( const int& val ) { return val > 100; } ), L"Any not working!" );
+            Assert::IsTrue( range.All( [] ( const int& val ) { return val > 0; } ), L"All not working!" );
+
+            //The size of a map is known, so counting does not evaluate it
+            calls = 0;
+            Assert::IsTrue( range.Count() == 9 && calls == 0, L"Count of map evaluates elements!" );
+         }
+
+         //Parallel
+         {
+            std::vector<int> large;
+            for ( int i = 0; i < 10000; i++ ) large.push_back( ( i * 7919 ) % 10007 );
+
+            Threading::ThreadPool pool( 3 );
+            Lazy::Parallel policy( 16, &pool );
+
+            auto range = Lazy::MakeLazy( large ).Filter( [] ( const int& val ) { return val % 3 == 0; } )
+                                                .Map( [] ( const int& val ) { return static_cast<long long>( val ); } );
+
+            Assert::IsTrue( range.Sum( policy ) == range.Sum(), L"Parallel sum not working!" );
+            Assert::IsTrue( range.Count( policy ) == range.Count(), L"Parallel count not working!" );
+            Assert::IsTrue( range.Min( policy ).val == range.Min().val, L"Parallel min not working!" );
+            Assert::IsTrue( range.Max( policy ).val == range.Max().val, L"Parallel max not working!" );
+
+            auto maxBit = range.Fold( 0LL, [] ( long long acc, long long val ) { return acc | val; }, policy );
+            Assert::IsTrue( maxBit == 16383, L"Parallel fold not working!" );
+         }
+      }
+
+      TEST_METHOD( TestCache )
+      {
+         std::vector<int> vec = {1,2,3,4,5,6,7,8,9};
+
+         size_t mapCalls = 0;
+         auto cached = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 3 != 0; } )
+                                            .Map( [&] ( const int& val ) { mapCalls++; return val * 2; } )
+                                            .Cache();
+         Assert::IsTrue( mapCalls == 0, L"Cache evaluates elements before they are requested!" );
+
+         //Partial evaluation only evaluates the requested elements
+         auto first = cached.First();
+         Assert::IsTrue( first && first.val == 2, L"First on cached range not working!" );
+         Assert::IsTrue( mapCalls == 1, L"Cache evaluates elements ahead of time!" );
+
+         //Repeated iteration and dereferencing reads from the cache
+         auto cachedVec = cached.ToVector();
+         Assert::IsTrue( cachedVec.size() == 6 && cachedVec[5] == 16, L"Cached range returns wrong elements!" );
+         Assert::IsTrue( mapCalls == 6, L"Cache evaluates elements more than once!" );
+
+         std::vector<int> pulled;
+         for ( auto iter = std::begin( cached ); iter != std::end( cached ); ++iter )
+         {
+            pulled.push_back( *iter );
+            pulled.back() = *iter;
+         }
+         Assert::IsTrue( pulled == cachedVec, L"Pull iteration over cached range not working!" );
+
+         auto copy = cached;
+         Assert::IsTrue( copy.Map( [] ( const int& val ) { return val + 1; } ).Sum() == 60, L"Map over cached range not working!" );
+         Assert::IsTrue( mapCalls == 6, L"Copies of a cached range do not share the cache!" );
+
+         //Empty range
+         auto empty = Lazy::MakeLazy( std::vector<int>() ).Cache();
+         Assert::IsTrue( empty.ToVector().size() == 0, L"Cache over empty range not working!" );
+         for ( auto val : empty ) Assert::Fail( L"Cache over empty range must not have elements!" );
+      }
+
+      TEST_METHOD( TestFileSources )
+      {
+         //Lines
+         {
+            const char* path = "LazyTest_Lines.txt";
+            {
+               std::ofstream file( path, std::ios::binary );
+               file << "first\r\n\nthis line is longer than the buffer\nlast";
+            }
+
+            auto lines = Lazy::MakeLazy( Lazy::ReadLines( path, 8 ) );
+            std::vector<std::string> read;
+            lines.ForEach( [&] ( std::string_view line ) { read.push_back( std::string( line ) ); } );
+
+            Assert::IsTrue( read.size() == 4, L"Wrong number of lines!" );
+            Assert::IsTrue( read[0] == "first", L"Line break is not removed!" );
+            Assert::IsTrue( read[1].empty(), L"Empty line not working!" );
+            Assert::IsTrue( read[2] == "this line is longer than the buffer", L"Line larger than the buffer not working!" );
+            Assert::IsTrue( read[3] == "last", L"Last line without line break not working!" );
+
+            //Each iteration reads the file again
+            auto lengths = lines.Map( [] ( const std::string_view& line ) { return line.size(); } );
+            Assert::IsTrue( lengths.Sum() == 44, L"Map over lines not working!" );
+            Assert::IsTrue( lengths.Filter( [] ( const size_t& length ) { return length > 4; } ).Count() == 2, L"Filter over lines not working!" );
+
+            std::vector<std::string> pulled;
+            for ( auto line : lines.Limit( 2 ) ) pulled.push_back( std::string( line ) );
+            Assert::IsTrue( pulled.size() == 2 && pulled[0] == "first", L"Pull iteration over lines not working!" );
+
+            std::remove( path );
+            auto empty = Lazy::MakeLazy( Lazy::ReadLines( "LazyTest_Empty.txt" ) );
+            std::ofstream( "LazyTest_Empty.txt" ).close();
+            Assert::IsTrue( empty.Count() == 0, L"Empty file must not have lines!" );
+            std::remove( "LazyTest_Empty.txt" );
+         }
+
+         //Records
+         {
+            const char* path = "LazyTest_Records.bin";
+            {
+               std::ofstream file( path, std::ios::binary );
+               for ( int i = 0; i < 1000; i++ ) file.write( reinterpret_cast<const char*>( &i ), sizeof( i ) );
+               file.write( "xy", 2 ); //Incomplete record
+            }
+
+            auto records = Lazy::MakeLazy( Lazy::ReadRecords<int>( path, 16 ) );
+            Assert::IsTrue( records.Count() == 1000, L"Wrong number of records!" );
+            Assert::IsTrue( records.Sum() == 499500, L"Wrong records!" );
+            Assert::IsTrue( records.Filter( [] ( const int& val ) { return val >= 990; } ).First().val == 990, L"Filter over records not working!" );
+
+            std::remove( path );
+         }
+      }
+
+      TEST_METHOD( TestFlatMapAndConcat )
+      {
+         struct Order
+         {
+            int id;
+            std::vector<int> items;
+         };
+         std::vector<Order> orders = { { 1, { 1, 2 } }, { 2, {} }, { 3, { 3 } }, { 4, {} } };
+
+         //Returned by reference, so the items are not copied
+         auto items = Lazy::MakeLazy( orders ).FlatMap( [] ( const Order& order ) -> const std::vector<int>& { return order.items; } );
+         std::vector<int> pulled;
+         for ( auto item : items ) pulled.push_back( item );
+         Assert::IsTrue( pulled == std::vector<int>( { 1, 2, 3 } ), L"FlatMap over references not working!" );
+         Assert::IsTrue( items.ToVector() == pulled, L"FlatMap push not working!" );
+         Assert::IsTrue( items.Sum( Lazy::Parallel( 1 ) ) == 6, L"Parallel FlatMap not working!" );
+
+         //Returned by value, from elements that are only temporaries
+         auto repeated = Lazy::MakeLazy( orders )
+            .Map( [] ( const Order& order ) { return order; } )
+            .FlatMap( [] ( const Order& order ) { return Lazy::MakeLazy( order.items ).Map( [] ( const int& val ) { return val * 10; } ); } );
+         std::vector<int> repeatedPulled;
+         for ( auto item : repeated ) repeatedPulled.push_back( item );
+         Assert::IsTrue( repeatedPulled == std::vector<int>( { 10, 20, 30 } ), L"FlatMap over temporary elements not working!" );
+         Assert::IsTrue( repeated.ToVector() == repeatedPulled, L"FlatMap over LazyRanges not working!" );
+
+         std::vector<int> empty;
+         Assert::IsTrue( Lazy::MakeLazy( empty ).FlatMap( [] ( const int& ) { return std::vector<int>( 1, 1 ); } ).Count() == 0, L"FlatMap over empty range not working!" );
+
+         int pulls = 0;
+         auto counted = Lazy::MakeLazy( orders ).FlatMap( [&pulls] ( const Order& order ) -> const std::vector<int>& { pulls++; return order.items; } );
+         Assert::IsTrue( counted.First().val == 1 && pulls == 1, L"FlatMap must stop with the sink!" );
+
+         //Copies share the expansion of the current element, but advance on their own
+         int calls = 0;
+         auto expanded = Lazy::MakeLazy( orders ).FlatMap( [&calls] ( const Order& order ) { calls++; return order.items; } );
+         auto it = expanded.begin();
+         auto copy = it;
+         ++copy;
+         Assert::IsTrue( *it == 1 && *copy == 2 && calls == 1, L"Copying a FlatMap iterator expands the element again!" );
+         it = copy;
+         ++it;
+         Assert::IsTrue( *it == 3 && *copy == 2 && it != copy, L"Assigning a FlatMap iterator not working!" );
+         ++it;
+         Assert::IsTrue( it == expanded.end() && calls == 4, L"FlatMap iterator not working!" );
+
+         //Concat
+         std::vector<int> first = { 1, 2, 3 };
+         std::list<int> second = { 4, 5 };
+         auto concat = Lazy::MakeLazy( first ).Filter( [] ( const int& val ) { return val != 2; } ).Concat( Lazy::MakeLazy( second ) );
+         std::vector<int> concatPulled;
+         for ( auto val : concat ) concatPulled.push_back( val );
+         Assert::IsTrue( concatPulled == std::vector<int>( { 1, 3, 4, 5 } ), L"Concat not working!" );
+         Assert::IsTrue( concat.ToVector() == concatPulled, L"Concat push not working!" );
+         Assert::IsTrue( *std::max_element( concat.begin(), concat.end() ) == 5, L"Assigning a concat iterator not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( first ).Concat( Lazy::MakeLazy( first ) ).Size() == 6, L"Concat size not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( empty ).Concat( Lazy::MakeLazy( first ) ).Sum() == 6, L"Concat with empty range not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( first ).Concat( Lazy::MakeLazy( empty ) ).Limit( 5 ).Count() == 3, L"Concat with empty range not working!" );
+
+         int otherCalls = 0;
+         auto lazyOther = Lazy::MakeLazy( first ).Concat( Lazy::MakeLazy( first ).Filter( [&otherCalls] ( const int& ) { otherCalls++; return true; } ) );
+         std::vector<int> limited;
+         for ( auto val : lazyOther.Limit( 3 ) ) limited.push_back( val );
+         Assert::IsTrue( limited.size() == 3 && otherCalls == 0, L"Concat must not evaluate the second range early!" );
       }
 
+      TEST_METHOD( TestChunkAndWindow )
+      {
+         std::vector<int> vec = { 1, 2, 3, 4, 5, 6, 7 };
+         auto sum = [] ( const Lazy::BufferView<int>& view )
+         {
+            int sum = 0;
+            for ( auto val : view ) sum += val;
+            return sum;
+         };
+
+         //Chunk
+         auto chunks = Lazy::MakeLazy( vec ).Chunk( 3 );
+         Assert::IsTrue( chunks.Size() == 3, L"Chunk size not working!" );
+         std::vector<int> chunkSums;
+         for ( auto chunk : chunks ) chunkSums.push_back( sum( chunk ) );
+         Assert::IsTrue( chunkSums == std::vector<int>( { 6, 15, 7 } ), L"Chunk iteration not working!" );
+         Assert::IsTrue( chunks.Map( sum ).ToVector() == chunkSums, L"Chunk push not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).Chunk( 7 ).Map( sum ).ToVector() == std::vector<int>( { 28 } ), L"Single chunk not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).Limit( 6 ).Chunk( 2 ).Count() == 3, L"Chunk without remainder not working!" );
+
+         auto last = Lazy::MakeLazy( vec ).Chunk( 3 ).Map( [] ( const Lazy::BufferView<int>& view ) { return view.back(); } );
+         Assert::IsTrue( last.ToVector() == std::vector<int>( { 3, 6, 7 } ), L"Chunk view not working!" );
+
+         //Iterators can be assigned, also below other operations
+         auto chunkIt = chunks.begin();
+         chunkIt = chunks.end();
+         auto lastIt = last.begin();
+         lastIt = last.end();
+         Assert::IsTrue( chunkIt == chunks.end() && lastIt == last.end(), L"Assigning a chunk iterator not working!" );
+
+         //Window
+         auto windows = Lazy::MakeLazy( vec ).Window( 3 );
+         Assert::IsTrue( windows.Size() == 5, L"Window size not working!" );
+         std::vector<int> windowSums;
+         for ( auto window : windows ) windowSums.push_back( sum( window ) );
+         Assert::IsTrue( windowSums == std::vector<int>( { 6, 9, 12, 15, 18 } ), L"Window iteration not working!" );
+         Assert::IsTrue( windows.Map( sum ).ToVector() == windowSums, L"Window push not working!" );
+
+         auto firsts = Lazy::MakeLazy( vec ).Window( 3 ).Map( [] ( const Lazy::BufferView<int>& view ) { return view[0] * 10 + view[2]; } );
+         Assert::IsTrue( firsts.ToVector() == std::vector<int>( { 13, 24, 35, 46, 57 } ), L"Window order not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).Window( 1 ).Map( sum ).ToVector() == vec, L"Window of one element not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).Window( 8 ).Count() == 0, L"Window larger than the range not working!" );
+         auto windowIt = windows.begin();
+         windowIt = windows.end();
+         Assert::IsTrue( windowIt == windows.end(), L"Assigning a window iterator not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).Window( 2 ).Map( [] ( const Lazy::BufferView<int>& view ) { return Lazy::MakeLazy( view ).Sum(); } ).Max().val == 13,
+                         L"LazyRange over a window not working!" );
+
+         int predCalls = 0;
+         auto filtered = Lazy::MakeLazy( vec ).Filter( [&predCalls] ( const int& ) { predCalls++; return true; } ).Window( 2 ).Limit( 2 );
+         size_t count = 0;
+         for ( auto window : filtered ) count += window.size();
+         Assert::IsTrue( count == 4 && predCalls == 3, L"Window must not evaluate elements ahead!" );
+
+         Assert::ExpectException<std::exception>( [&vec] () { Lazy::MakeLazy( vec ).Window( 0 ); }, L"Window of size zero must throw!" );
+      }
+
+      TEST_METHOD( TestGroupBy )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 100000; i++ ) vec.push_back( i );
+         auto key = [] ( const int& val ) { return val % 7; };
+         auto plus = [] ( long long acc, long long val ) { return acc + val; };
+
+         auto sums = Lazy::MakeLazy( vec ).AggregateBy( key, 0LL, plus );
+         Assert::IsTrue( sums.size() == 7, L"Wrong number of keys!" );
+         long long expected = 0;
+         for ( int i = 3; i < 100000; i += 7 ) expected += i;
+         Assert::IsTrue( *sums.Find( 3 ) == expected, L"Wrong aggregate!" );
+
+         int idx = 0;
+         for ( auto& entry : sums ) Assert::IsTrue( entry.first == idx++, L"Keys must be in the order of their first occurrence!" );
+
+         auto parallelSums = Lazy::MakeLazy( vec ).AggregateBy( key, 0LL, plus, Lazy::Parallel( 1000 ) );
+         Assert::IsTrue( parallelSums.size() == 7 && *parallelSums.Find( 3 ) == expected, L"Parallel AggregateBy not working!" );
+         idx = 0;
+         for ( auto& entry : parallelSums ) Assert::IsTrue( entry.first == idx++, L"Parallel AggregateBy must keep the order of the keys!" );
+
+         auto counts = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val < 10; } )
+            .AggregateBy( [] ( const int& val ) { return std::to_string( val % 2 ); }, size_t( 0 ), [] ( size_t acc, const int& ) { return acc + 1; } );
+         Assert::IsTrue( counts.size() == 2 && *counts.Find( "0" ) == 5 && !counts.Find( "2" ), L"AggregateBy with string keys not working!" );
+
+         auto groups = Lazy::MakeLazy( vec ).GroupBy( key );
+         auto parallelGroups = Lazy::MakeLazy( vec ).GroupBy( key, Lazy::Parallel( 1000 ) );
+         Assert::IsTrue( groups.size() == 7 && parallelGroups.size() == 7, L"Wrong number of groups!" );
+         for ( auto& group : groups )
+         {
+            auto& parallelGroup = *parallelGroups.Find( group.first );
+            Assert::IsTrue( group.second == parallelGroup, L"Parallel GroupBy must keep the order of the elements!" );
+            Assert::IsTrue( group.second.front() == group.first && group.second.size() == ( 100000 - group.first + 6 ) / 7, L"Wrong group!" );
+         }
+
+         std::list<int> list = { 3, 1, 3 };
+         auto listGroups = Lazy::MakeLazy( list ).GroupBy( [] ( const int& val ) { return val; }, Lazy::Parallel() );
+         Assert::IsTrue( listGroups.size() == 2 && listGroups.Find( 3 )->size() == 2, L"GroupBy over a list not working!" );
+      }
+
+      TEST_METHOD( TestOrderBy )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 1000; i++ ) vec.push_back( ( i * 7919 ) % 1000 );
+         auto identity = [] ( const int& val ) { return val; };
+
+         auto sorted = Lazy::MakeLazy( vec ).OrderBy( identity );
+         Assert::IsTrue( sorted.Size() == 1000, L"OrderBy size not working!" );
+         std::vector<int> pulled;
+         for ( auto val : sorted ) pulled.push_back( val );
+         Assert::IsTrue( pulled.size() == 1000 && std::is_sorted( pulled.begin(), pulled.end() ), L"OrderBy not working!" );
+         Assert::IsTrue( sorted.ToVector() == pulled, L"OrderBy push not working!" );
+         Assert::IsTrue( *std::max_element( sorted.begin(), sorted.end() ) == 999, L"Assigning an OrderBy iterator not working!" );
+
+         //Top-k
+         auto top = Lazy::MakeLazy( vec ).OrderByDescending( identity ).Limit( 5 );
+         Assert::IsTrue( top.ToVector() == std::vector<int>( { 999, 998, 997, 996, 995 } ), L"OrderByDescending with Limit not working!" );
+         std::vector<int> topPulled;
+         for ( auto val : top ) topPulled.push_back( val );
+         Assert::IsTrue( topPulled == top.ToVector(), L"Pulling top-k not working!" );
+         Assert::IsTrue( top.Limit( 2 ).Size() == 2 && top.Limit( 10 ).Size() == 5, L"Limit after top-k not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).OrderBy( identity ).Limit( 0 ).Count() == 0, L"Limit 0 not working!" );
+         Assert::IsTrue( Lazy::MakeLazy( vec ).OrderBy( identity ).Limit( 5000 ).ToVector() == pulled, L"Limit larger than the range not working!" );
+
+         auto odd = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 2 == 1; } ).OrderBy( identity ).Limit( 3 ).ToVector();
+         Assert::IsTrue( odd == std::vector<int>( { 1, 3, 5 } ), L"Top-k over a filter not working!" );
+
+         //The key is used for comparisons, not the element
+         std::list<std::string> words = { "ccc", "a", "dddd", "bb" };
+         auto byLength = Lazy::MakeLazy( words ).OrderByDescending( [] ( const std::string& word ) { return word.size(); } ).Limit( 2 );
+         Assert::IsTrue( byLength.ToVector() == std::vector<std::string>( { "dddd", "ccc" } ), L"OrderBy with key not working!" );
+         Assert::IsTrue( byLength.Map( [] ( const std::string& word ) { return word.size(); } ).Sum() == 7, L"Map after OrderBy not working!" );
+
+         //Each iteration sorts the current elements again
+         std::vector<int> mutableVec = { 3, 1, 2 };
+         auto mutableSorted = Lazy::MakeLazy( mutableVec ).OrderBy( identity );
+         Assert::IsTrue( mutableSorted.First().val == 1, L"Wrong first element!" );
+         mutableVec[2] = 0;
+         Assert::IsTrue( mutableSorted.First().val == 0, L"OrderBy must not cache its elements!" );
+      }
+
+      TEST_METHOD( TestReferencesAndOwnership )
+      {
+         struct Counted
+         {
+            Counted( int val, int* copies ) : val( val ), copies( copies ) {}
+            Counted( const Counted& other ) : val( other.val ), copies( other.copies ) { ++*copies; }
+            Counted( Counted&& other ) noexcept : val( other.val ), copies( other.copies ) {}
+            Counted& operator=( const Counted& other ) { val = other.val; copies = other.copies; ++*copies; return *this; }
+            Counted& operator=( Counted&& other ) noexcept { val = other.val; copies = other.copies; return *this; }
+
+            int val;
+            int* copies;
+         };
+
+         int copies = 0;
+         std::vector<Counted> vec;
+         for ( int i = 0; i < 10; i++ ) vec.push_back( Counted( i, &copies ) );
+         copies = 0;
+         auto even = [] ( const Counted& val ) { return val.val % 2 == 0; };
+
+         //Pulling through filter and limit yields references to the source elements
+         auto filtered = Lazy::MakeLazy( vec ).Filter( even ).Limit( 3 );
+         for ( auto& val : filtered ) Assert::IsTrue( &val >= vec.data() && &val < vec.data() + vec.size(), L"Filter must yield references!" );
+         Assert::IsTrue( copies == 0, L"Pulling must not copy!" );
+
+         //Each element is copied once into the result
+         auto result = filtered.ToVector();
+         Assert::IsTrue( result.size() == 3 && copies == 3, L"ToVector must copy each source element only once!" );
+
+         //Temporaries are moved into the result
+         copies = 0;
+         auto mapped = Lazy::MakeLazy( vec ).Map( [] ( const Counted& val ) { return Counted( val.val * 2, val.copies ); } ).Filter( even ).ToVector();
+         Assert::IsTrue( mapped.size() == 10 && copies == 0, L"ToVector must move temporaries!" );
+
+         //Ownership of temporary containers
+         auto owned = Lazy::MakeLazy( std::vector<int>( { 1, 2, 3, 4 } ) ).Filter( [] ( const int& val ) { return val > 1; } );
+         Assert::IsTrue( owned.Sum() == 9, L"Owned container not working!" );
+         Assert::IsTrue( owned.Map( [] ( const int& val ) { return val * 2; } ).Sum( Lazy::Parallel( 1 ) ) == 18, L"Parallel over owned container not working!" );
+         std::vector<int> ownedPulled;
+         for ( auto val : owned ) ownedPulled.push_back( val );
+         Assert::IsTrue( ownedPulled == std::vector<int>( { 2, 3, 4 } ), L"Pulling from owned container not working!" );
+
+         auto moved = std::vector<int>( { 5, 6 } );
+         auto movedRange = Lazy::MakeLazy( std::move( moved ) );
+         moved = std::vector<int>( { 1 } );
+         Assert::IsTrue( movedRange.Size() == 2 && movedRange.Sum() == 11, L"MakeLazy must take ownership of moved containers!" );
+
+         //Move-only elements
+         std::vector<std::unique_ptr<int>> pointers;
+         for ( int i = 0; i < 5; i++ ) pointers.push_back( std::unique_ptr<int>( new int( i ) ) );
+         auto ownedPointers = Lazy::MakeLazy( std::move( pointers ) );
+         Assert::IsTrue( ownedPointers.Map( [] ( const std::unique_ptr<int>& ptr ) { return *ptr; } ).Sum() == 10, L"Move-only source elements not working!" );
+         auto created = Lazy::MakeLazy( vec )
+            .Map( [] ( const Counted& val ) { return std::unique_ptr<int>( new int( val.val ) ); } )
+            .Filter( [] ( const std::unique_ptr<int>& ptr ) { return *ptr > 6; } )
+            .ToVector();
+         Assert::IsTrue( created.size() == 3 && *created[0] == 7, L"Move-only results not working!" );
+      }
+
+      TEST_METHOD( TestInstrumentation )
+      {
+#ifdef LAZY_INSTRUMENTATION
+         std::vector<int> vec;
+         for ( int i = 0; i < 100; i++ ) vec.push_back( i );
+
+         auto range = Lazy::MakeLazy( vec )
+            .Filter( [] ( const int& val ) { return val % 4 == 0; } )
+            .Map( [] ( const int& val ) { return val * 2; } )
+            .Limit( 10 );
+         Assert::IsTrue( range.Report().stages.size() == 3, L"Wrong number of stages!" );
+         Assert::IsTrue( range.Report().stages[0].elementsIn == 0, L"Nothing must be recorded before evaluation!" );
+
+         Assert::IsTrue( range.Sum() == 360, L"Instrumented range not working!" );
+         auto report = range.Report();
+         auto& filter = report.stages[0];
+         auto& map = report.stages[1];
+         auto& limit = report.stages[2];
+         Assert::IsTrue( std::string( filter.name ) == "Filter" && std::string( map.name ) == "Map" && std::string( limit.name ) == "Limit", L"Wrong stage names!" );
+         //The limit stops the evaluation after the 10th element, i.e. after source element 36
+         Assert::IsTrue( filter.elementsIn == 37 && filter.elementsOut == 10, L"Wrong filter counts!" );
+         Assert::IsTrue( map.elementsIn == 10 && map.elementsOut == 10 && limit.elementsOut == 10, L"Wrong map or limit counts!" );
+         Assert::IsTrue( filter.Selectivity() > 0.27 && filter.Selectivity() < 0.28, L"Wrong selectivity!" );
+         Assert::IsFalse( report.ToString().empty(), L"Report must not be empty!" );
+
+         //Pulling counts as well, and copies of the range share the statistics
+         auto copy = range;
+         for ( auto val : copy ) (void)val;
+         Assert::IsTrue( range.Report().stages[2].elementsOut == 20, L"Pulling not recorded!" );
+
+         //Parallel evaluation records into the same statistics
+         auto mapped = Lazy::MakeLazy( vec ).Map( [] ( const int& val ) { return val + 1; } );
+         Assert::IsTrue( mapped.Sum( Lazy::Parallel( 8 ) ) == 5050, L"Parallel instrumented range not working!" );
+         Assert::IsTrue( mapped.Report().stages[0].elementsIn == 100, L"Parallel evaluation not recorded!" );
+#endif
+      }
+
+      TEST_METHOD( TestRewrites )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 100; i++ ) vec.push_back( i );
+
+         auto addOne = [] ( const int& val ) { return val + 1; };
+         auto half = [] ( const int& val ) { return val * 0.5; };
+         auto isEven = [] ( const int& val ) { return val % 2 == 0; };
+         auto isSmall = [] ( const int& val ) { return val < 20; };
+
+         //Adjacent maps are fused, the intermediate type is kept
+         auto mapped = Lazy::MakeLazy( vec ).Map( addOne ).Map( half ).Map( [] ( const double& val ) { return val * 4; } );
+         auto mappedVec = mapped.ToVector();
+         Assert::IsTrue( mappedVec.size() == 100 && mappedVec[0] == 2.0 && mappedVec[99] == 200.0, L"Fused maps not working!" );
+
+         //Adjacent filters are merged, the first predicate is evaluated first
+         int secondCalls = 0;
+         auto filtered = Lazy::MakeLazy( vec ).Filter( isSmall ).Filter( [&secondCalls] ( const int& val ) { secondCalls++; return val % 2 == 0; } );
+         Assert::IsTrue( filtered.Count() == 10, L"Merged filters not working!" );
+         Assert::IsTrue( secondCalls == 20, L"Merged filters evaluate the second predicate for too many elements!" );
+
+         //A limit after a map is moved below it
+         int mapCalls = 0;
+         auto limited = Lazy::MakeLazy( vec ).Filter( isEven ).Map( [&mapCalls] ( const int& val ) { mapCalls++; return val * 3; } ).Limit( 5 );
+         auto limitedVec = limited.ToVector();
+         Assert::IsTrue( limitedVec.size() == 5 && limitedVec[4] == 24, L"Limit after map not working!" );
+         Assert::IsTrue( mapCalls == 5, L"Map evaluated past the limit!" );
+         int pulled = 0;
+         for ( auto val : limited ) pulled += val;
+         Assert::IsTrue( pulled == 60, L"Pulling a limit after map not working!" );
+
+         //...where OrderBy absorbs it into its bounded heap
+         auto top = Lazy::MakeLazy( vec ).OrderByDescending( [] ( const int& val ) { return val; } ).Map( addOne ).Limit( 3 ).ToVector();
+         Assert::IsTrue( top.size() == 3 && top[0] == 100 && top[2] == 98, L"Limit after OrderBy and map not working!" );
+
+#ifndef LAZY_INSTRUMENTATION
+         using _Source = std::vector<int>::const_iterator;
+         using _FusedMap = Lazy::LazyMap<int, double, _Source, Lazy::_ComposedMap<int, int, decltype( addOne ), decltype( half )>>;
+         Assert::IsTrue( std::is_same<decltype( std::begin( Lazy::MakeLazy( vec ).Map( addOne ).Map( half ) ) ), _FusedMap>::value, L"Maps are not fused!" );
+         using _MergedFilter = Lazy::LazyFilter<int, _Source, Lazy::_ConjoinedPred<int, decltype( isSmall ), decltype( isEven )>>;
+         Assert::IsTrue( std::is_same<decltype( std::begin( Lazy::MakeLazy( vec ).Filter( isSmall ).Filter( isEven ) ) ), _MergedFilter>::value, L"Filters are not merged!" );
+         using _PushedLimit = Lazy::LazyMap<int, int, Lazy::LazyLimit<int, _Source>, decltype( addOne )>;
+         Assert::IsTrue( std::is_same<decltype( std::begin( Lazy::MakeLazy( vec ).Map( addOne ).Limit( 2 ) ) ), _PushedLimit>::value, L"Limit is not moved below the map!" );
+#endif
+      }
+
+      TEST_METHOD( TestNextBatch )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 1000; i++ ) vec.push_back( i );
+
+         //Batches of any size return the same elements as the iterators
+         {
+            auto range = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 3 != 0; } ).Map( [] ( const int& val ) { return val * 2; } );
+            auto expected = range.ToVector();
+            for ( size_t size : { 1, 7, 300, 2000 } )
+            {
+               std::vector<int> batches, batch( size );
+               auto cur = std::begin( range );
+               auto end = std::end( range );
+               while ( size_t read = Lazy::NextBatch( cur, end, batch.data(), size ) )
+               {
+                  Assert::IsTrue( read == size || cur == end, L"Batch not filled before the end!" );
+                  batches.insert( batches.end(), batch.begin(), batch.begin() + read );
+               }
+               Assert::IsTrue( batches == expected, L"Batches don't match the range!" );
+            }
+         }
+
+         //A limit does not evaluate elements past it
+         {
+            int predCalls = 0;
+            auto range = Lazy::MakeLazy( vec ).Filter( [&predCalls] ( const int& val ) { predCalls++; return val % 2 == 0; } ).Limit( 10 );
+            int batch[16];
+            auto cur = std::begin( range );
+            size_t read = Lazy::NextBatch( cur, std::end( range ), batch, 16 );
+            Assert::IsTrue( read == 10 && batch[9] == 18 && cur == std::end( range ), L"Batch over limit not working!" );
+            Assert::IsTrue( predCalls == 19, L"Batch over limit evaluates elements past the limit!" );
+         }
+
+         //Other values and operations are read element by element
+         {
+            std::vector<std::string> words = { "a", "bb", "ccc", "dd", "e" };
+            auto range = Lazy::MakeLazy( words ).Filter( [] ( const std::string& word ) { return word.size() > 1; } ).Concat( Lazy::MakeLazy( words ) );
+            std::string batch[5];
+            auto cur = std::begin( range );
+            size_t read = Lazy::NextBatch( cur, std::end( range ), batch, 5 );
+            Assert::IsTrue( read == 5 && batch[0] == "bb" && batch[2] == "dd" && batch[3] == "a" && batch[4] == "bb", L"Element-wise batch not working!" );
+            read = Lazy::NextBatch( cur, std::end( range ), batch, 5 );
+            Assert::IsTrue( read == 3 && batch[2] == "e" && cur == std::end( range ), L"Element-wise batch not working at the end!" );
+         }
+      }
+
+      TEST_METHOD( TestPipelined )
+      {
+         std::list<int> list;
+         for ( int i = 0; i < 10000; i++ ) list.push_back( i );
+
+         //Each map runs on its own thread and the order is kept
+         {
+            auto mainThread = std::this_thread::get_id();
+            std::thread::id decodeThread, transformThread, encodeThread;
+            auto range = Lazy::MakeLazy( list )
+               .Map( [&decodeThread] ( const int& val ) { decodeThread = std::this_thread::get_id(); return val * 2; } )
+               .Pipelined( 16 )
+               .Map( [&transformThread] ( const int& val ) { transformThread = std::this_thread::get_id(); return val + 1; } )
+               .Pipelined()
+               .Map( [&encodeThread] ( const int& val ) { encodeThread = std::this_thread::get_id(); return std::to_string( val ); } );
+
+            auto vec = range.ToVector();
+            Assert::IsTrue( vec.size() == 10000 && vec[0] == "1" && vec[9999] == "19999", L"Pipelined ToVector not working!" );
+            bool ordered = true;
+            for ( size_t i = 0; i < vec.size(); i++ ) ordered = ordered && vec[i] == std::to_string( i * 2 + 1 );
+            Assert::IsTrue( ordered, L"Pipelined range not in order!" );
+            Assert::IsTrue( decodeThread != transformThread && decodeThread != mainThread && transformThread != mainThread, L"Maps not on their own threads!" );
+            Assert::IsTrue( encodeThread == mainThread, L"Last map not on the consuming thread!" );
+
+            //Iterating pulls from the same queue
+            size_t idx = 0;
+            for ( const auto& val : range )
+            {
+               ordered = ordered && val == std::to_string( idx * 2 + 1 );
+               idx++;
+            }
+            Assert::IsTrue( ordered && idx == 10000, L"Iterating a pipelined range not working!" );
+         }
+
+         //Stopping early stops the thread, a limit is moved into the thread
+         {
+            std::atomic<int> mapCalls( 0 );
+            auto range = Lazy::MakeLazy( list ).Map( [&mapCalls] ( const int& val ) { mapCalls++; return val; } ).Pipelined( 4 );
+            Assert::IsTrue( range.First().val == 0, L"First of pipelined range not working!" );
+            Assert::IsTrue( range.Any( [] ( const int& val ) { return val == 500; } ), L"Any of pipelined range not working!" );
+
+            mapCalls = 0;
+            auto limited = range.Limit( 3 ).ToVector();
+            Assert::IsTrue( limited.size() == 3 && limited[2] == 2, L"Limit of pipelined range not working!" );
+#ifndef LAZY_INSTRUMENTATION
+            Assert::IsTrue( mapCalls == 3, L"Pipelined thread runs past the limit!" );
+#endif
+            auto empty = Lazy::MakeLazy( std::list<int>() ).Pipelined().ToVector();
+            Assert::IsTrue( empty.empty(), L"Empty pipelined range not working!" );
+         }
+
+         //Either side sleeps while the other one is slow, and wakes up again
+         {
+            auto slowProducer = Lazy::MakeLazy( list ).Limit( 20 )
+               .Map( [] ( const int& val ) { std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) ); return val; } )
+               .Pipelined( 4 );
+            Assert::IsTrue( slowProducer.Sum() == 190, L"Waiting for a slow producer not working!" );
+
+            auto slowConsumer = Lazy::MakeLazy( list ).Pipelined( 2 ).Limit( 20 )
+               .Map( [] ( const int& val ) { std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) ); return val; } );
+            Assert::IsTrue( slowConsumer.Sum() == 190, L"Waiting for a slow consumer not working!" );
+
+            auto filtered = Lazy::MakeLazy( list ).Pipelined().Filter( [] ( const int& val ) { return val % 2 == 0; } );
+            auto it = filtered.begin();
+            it = filtered.end();
+            Assert::IsTrue( it == filtered.end(), L"Assigning a pipelined iterator not working!" );
+         }
+
+         //Exceptions are rethrown on the consuming thread
+         {
+            auto range = Lazy::MakeLazy( list )
+               .Map( [] ( const int& val ) { if ( val == 5000 ) throw std::runtime_error( "Decode failed" ); return val; } )
+               .Pipelined();
+            bool thrown = false;
+            try
+            {
+               range.Sum();
+            }
+            catch ( const std::runtime_error& )
+            {
+               thrown = true;
+            }
+            Assert::IsTrue( thrown, L"Exception not rethrown!" );
+         }
+      }
+
+      TEST_METHOD( TestDistinct )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 10000; i++ ) vec.push_back( ( i * 7 ) % 1000 );
+
+         //The first occurrence of each element is kept, in order
+         auto distinct = Lazy::MakeLazy( vec ).Distinct();
+         auto distinctVec = distinct.ToVector();
+         Assert::IsTrue( distinctVec.size() == 1000 && distinctVec[0] == 0 && distinctVec[1] == 7 && distinctVec[999] == 993, L"Distinct not working!" );
+         std::vector<int> pulled;
+         for ( auto val : distinct ) pulled.push_back( val );
+         Assert::IsTrue( pulled == distinctVec, L"Iterating distinct range not working!" );
+
+         auto prefiltered = Lazy::MakeLazy( vec ).Distinct( Lazy::BloomPrefilter( 1000 ) ).ToVector();
+         Assert::IsTrue( prefiltered == distinctVec, L"Distinct with Bloom filter not working!" );
+
+         //Keys of the elements
+         std::vector<std::string> words = { "apple", "avocado", "banana", "blueberry", "cherry", "apricot" };
+         auto byLetter = Lazy::MakeLazy( words ).DistinctBy( [] ( const std::string& word ) { return word[0]; } ).ToVector();
+         Assert::IsTrue( byLetter.size() == 3 && byLetter[0] == "apple" && byLetter[1] == "banana" && byLetter[2] == "cherry", L"DistinctBy not working!" );
+         auto byLength = Lazy::MakeLazy( words ).DistinctBy( [] ( const std::string& word ) { return word.size(); }, Lazy::BloomPrefilter( 10, 0.1 ) );
+         Assert::IsTrue( byLength.Count() == 4, L"DistinctBy with Bloom filter not working!" );
+         auto lengthIt = byLength.begin();
+         lengthIt = byLength.end();
+         Assert::IsTrue( lengthIt == byLength.end(), L"Assigning a distinct iterator not working!" );
+
+         //Distinct streams, so a limit stops it early
+         int mapCalls = 0;
+         auto limited = Lazy::MakeLazy( vec ).Map( [&mapCalls] ( const int& val ) { mapCalls++; return val % 10; } ).Distinct().Limit( 3 ).ToVector();
+         Assert::IsTrue( limited.size() == 3 && limited[2] == 4, L"Limit after distinct not working!" );
+         Assert::IsTrue( mapCalls == 3, L"Distinct evaluates elements past the limit!" );
+      }
+
+      TEST_METHOD( TestSketchTerminals )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 200000; i++ ) vec.push_back( ( i * 7919 ) % 50000 );
+         auto range = Lazy::MakeLazy( vec );
+
+         size_t distinct = range.CountDistinctApprox();
+         Assert::IsTrue( distinct > 48000 && distinct < 52000, L"CountDistinctApprox not working!" );
+         Assert::IsTrue( range.CountDistinctApprox( Lazy::Parallel( 1000 ) ) == distinct, L"Parallel CountDistinctApprox differs!" );
+         size_t small = range.Filter( [] ( const int& val ) { return val < 100; } ).CountDistinctApprox();
+         Assert::IsTrue( small >= 98 && small <= 102, L"Small distinct count not accurate!" );
+
+         auto quantiles = range.QuantilesApprox();
+         Assert::IsTrue( quantiles.Count() == vec.size(), L"Quantile sketch misses elements!" );
+         Assert::IsTrue( std::abs( quantiles.Quantile( 0.99 ) - 49500 ) < 1000, L"QuantilesApprox not working!" );
+         auto parallel = range.QuantilesApprox( 200, Lazy::Parallel( 1000 ) );
+         Assert::IsTrue( parallel.Count() == vec.size() && std::abs( parallel.Quantile( 0.5 ) - 25000 ) < 1000, L"Parallel QuantilesApprox not working!" );
+
+         //Sketches of separate ranges merge
+         auto low = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val < 25000; } ).QuantilesApprox();
+         low.Merge( Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val >= 25000; } ).QuantilesApprox() );
+         Assert::IsTrue( low.Count() == vec.size() && std::abs( low.Quantile( 0.9 ) - 45000 ) < 1000, L"Merged sketches not working!" );
+      }
+
+      TEST_METHOD( TestPreparedPipeline )
+      {
+         //Binding must not copy the functions of the pipeline
+         int copies = 0;
+         auto pipeline = Lazy::Prepare<std::vector<int>>()
+            .Filter( CountingPred( &copies ) )
+            .Map( [] ( const int& val ) { return val * 10; } )
+            .Map( [] ( const int& val ) { return std::to_string( val ); } );
+         int prepareCopies = copies;
+
+         std::vector<int> first = { 1, 2, 3, 4, 5, 6 };
+         std::vector<int> second = { 8, 9, 10 };
+         auto firstVec = pipeline.Bind( first ).ToVector();
+         Assert::IsTrue( firstVec.size() == 3 && firstVec[0] == "20" && firstVec[2] == "60", L"Bound pipeline not working!" );
+         std::vector<std::string> secondVec;
+         for ( const auto& val : pipeline.Bind( second ) ) secondVec.push_back( val );
+         Assert::IsTrue( secondVec.size() == 2 && secondVec[0] == "80" && secondVec[1] == "100", L"Rebinding pipeline not working!" );
+         Assert::IsTrue( pipeline.Bind( first.begin() + 3, first.end() ).Count() == 2, L"Binding subrange not working!" );
+         Assert::IsTrue( pipeline.Bind( std::vector<int>() ).ToVector().empty(), L"Binding empty container not working!" );
+         Assert::IsTrue( copies == prepareCopies, L"Binding copies the functions of the pipeline!" );
+         auto canBind = [] ( auto&& pipeline ) { return std::bool_constant<requires { std::forward<decltype( pipeline )>( pipeline ).Bind( std::declval<const std::vector<int>&>() ); }>(); };
+         static_assert( decltype( canBind( pipeline ) )::value && !decltype( canBind( std::move( pipeline ) ) )::value, "A temporary pipeline must not be bound!" );
+
+         //Same result as the chain on MakeLazy, also with operations appended after binding
+         std::vector<int> vec;
+         for ( int i = 0; i < 10000; i++ ) vec.push_back( i );
+         auto limited = Lazy::Prepare<std::vector<int>>().Filter( [] ( const int& val ) { return val % 3 == 0; } ).Limit( 100 );
+         auto expected = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 3 == 0; } ).Limit( 100 ).Sum();
+         Assert::IsTrue( limited.Bind( vec ).Sum() == expected, L"Limited pipeline not working!" );
+         Assert::IsTrue( limited.Bind( vec ).Map( [] ( const int& val ) { return val + 1; } ).Sum() == expected + 100, L"Operations after binding not working!" );
+
+         auto pairs = Lazy::Prepare<std::vector<int>>().FlatMap( [] ( const int& val ) { return std::vector<int>( 2, val ); } );
+         Assert::IsTrue( pairs.Bind( second ).ToVector() == std::vector<int>( { 8, 8, 9, 9, 10, 10 } ), L"FlatMap pipeline not working!" );
+
+         //Bound ranges keep the parallel evaluation of the chain
+         auto evens = Lazy::Prepare<std::vector<int>>().Filter( [] ( const int& val ) { return val % 2 == 0; } );
+         Assert::IsTrue( evens.Bind( vec ).Sum( Lazy::Parallel( 100 ) ) == evens.Bind( vec ).Sum(), L"Parallel bound pipeline not working!" );
+      }
+
+      TEST_METHOD( TestIteratorState )
+      {
+         std::vector<int> vec;
+         for ( int i = 0; i < 100; i++ ) vec.push_back( i );
+
+         //Iterators share the predicate instead of copying it
+         int copies = 0;
+         auto range = Lazy::MakeLazy( vec ).Filter( CountingPred( &copies ) ).Map( [] ( const int& val ) { return val * 3; } );
+         int buildCopies = copies;
+         int sum = 0;
+         for ( auto it = range.begin(), end = range.end(); it != end; ++it ) sum += *it;
+         auto copy = range.begin();
+         copy = range.end();
+         Assert::IsTrue( sum == 7350 && copy == range.end(), L"Iterating not working!" );
+         Assert::IsTrue( copies == buildCopies, L"Iterators copy the predicate!" );
+
+         //Only the position and a pointer to the operation per layer, the source bounds are kept once
+         std::function<bool( const int& )> isEven = [] ( const int& val ) { return val % 2 == 0; };
+         std::function<int( const int& )> triple = [] ( const int& val ) { return val * 3; };
+         auto chain = Lazy::MakeLazy( vec ).Filter( isEven ).Map( triple ).Filter( isEven ).Map( triple ).Limit( 10 );
+         Assert::IsTrue( sizeof( chain.begin() ) <= 128, L"Iterator of five operations larger than two cache lines!" );
+         Assert::IsTrue( chain.Sum() == 810, L"Chain not working!" );
+      }
+
+      TEST_METHOD( TestCheckedIteration )
+      {
+         std::vector<int> vec = { 1, 2, 3, 4 };
+         auto range = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 2 == 0; } ).Map( [] ( const int& val ) { return val * 10; } );
+         Assert::IsTrue( range.ToVector() == std::vector<int>( { 20, 40 } ), L"Iterating not working!" );
+#if LAZY_CHECKED_ITERATION
+         Assert::IsTrue( Lazy::CheckedIteration, L"Iteration must be checked!" );
+         Assert::ExpectException<std::exception>( [&range] () { *range.end(); }, L"Dereferencing end of map must throw!" );
+         Assert::ExpectException<std::exception>( [&vec] () { *Lazy::MakeLazy( vec ).Limit( 2 ).end(); }, L"Dereferencing end of limit must throw!" );
+#else
+         Assert::IsFalse( Lazy::CheckedIteration, L"Iteration must not be checked!" );
+#endif
+      }
+
+      TEST_METHOD( TestParallelFilter )
+      {
+         Threading::ThreadPool pool( 3 );
+
+         //Sizes around the 64 elements of a mask word, with more chunks than words and with few chunks
+         for ( size_t size : { 0, 1, 63, 64, 65, 1000, 100003 } )
+         {
+            std::vector<int> vec;
+            for ( size_t i = 0; i < size; i++ ) vec.push_back( static_cast<int>( ( i * 7919 ) % 1000 ) );
+            auto range = Lazy::MakeLazy( vec ).Filter( [] ( const int& val ) { return val % 3 == 0; } );
+            auto sequential = range.ToVector();
+            Assert::IsTrue( range.ToVector( Lazy::Parallel( 1, &pool ) ) == sequential, L"Parallel filter with small chunks differs!" );
+            Assert::IsTrue( range.ToVector( Lazy::Parallel( 4096, &pool ) ) == sequential, L"Parallel filter differs!" );
+         }
+
+         std::vector<std::string> words;
+         for ( int i = 0; i < 1000; i++ ) words.push_back( std::to_string( i ) );
+         auto sevens = Lazy::MakeLazy( words ).Filter( [] ( const std::string& word ) { return word.find( '7' ) != std::string::npos; } );
+         Assert::IsTrue( sevens.ToVector( Lazy::Parallel( 16, &pool ) ) == sevens.ToVector(), L"Parallel filter of strings differs!" );
+         Assert::IsTrue( Lazy::MakeLazy( words ).Filter( [] ( const std::string& word ) { return word.empty(); } ).ToVector( Lazy::Parallel( 16, &pool ) ).empty(), L"Filter selecting nothing not empty!" );
+         Assert::IsTrue( Lazy::MakeLazy( words ).Filter( [] ( const std::string& word ) { return !word.empty(); } ).ToVector( Lazy::Parallel( 16, &pool ) ) == words, L"Filter selecting everything not complete!" );
+
+         struct NoDefault
+         {
+            explicit NoDefault( int val ) : val( val ) {}
+
+            int val;
+         };
+         std::vector<NoDefault> wrapped;
+         for ( int i = 0; i < 1000; i++ ) wrapped.push_back( NoDefault( i ) );
+         auto odd = Lazy::MakeLazy( wrapped ).Filter( [] ( const NoDefault& val ) { return val.val % 2 != 0; } ).ToVector( Lazy::Parallel( 16, &pool ) );
+         Assert::IsTrue( odd.size() == 500 && odd.back().val == 999, L"Parallel filter without default constructor not working!" );
+
+         //Without worker threads, and with a single chunk, the parallel ToVector evaluates sequentially
+         Threading::ThreadPool noThreads( 0 );
+         auto thirds = Lazy::MakeLazy( words ).Filter( [] ( const std::string& word ) { return word.size() == 3; } );
+         Assert::IsTrue( thirds.ToVector( Lazy::Parallel( 16, &noThreads ) ) == thirds.ToVector(), L"Parallel filter without worker threads differs!" );
+         Assert::IsTrue( thirds.ToVector( Lazy::Parallel( 4096, &pool ) ) == thirds.ToVector(), L"Parallel filter with a single chunk differs!" );
+         auto lengths = Lazy::MakeLazy( words ).Map( [] ( const std::string& word ) { return word.size(); } );
+         Assert::IsTrue( lengths.ToVector( Lazy::Parallel( 16, &noThreads ) ) == lengths.ToVector(), L"Parallel map without worker threads differs!" );
+      }
 	};
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "Propositional.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ThinkingCode_Test
+{
+	TEST_CLASS(PropositionalTest)
+	{
+	public:
+		
+      TEST_METHOD( TestCheckValidity )
+      {
+         Assert::IsTrue( CheckValidity<Or<A, Not<A>>, A>() == Validity::Always, L"Tautology with one variable not detected!" );
+         Assert::IsTrue( CheckValidity<Equals<Implies<A, B>, Implies<Not<B>, Not<A>>>, A, B>() == Validity::Always, L"Contraposition not valid!" );
+         Assert::IsTrue( CheckValidity<And<Implies<A, B>, Not<Or<Not<A>, B>>>, A, B>() == Validity::Never, L"Contradiction with two variables not detected!" );
+         Assert::IsTrue( CheckValidity<Equals<Implies<A, B>, Implies<Not<A>, Not<B>>>, A, B>() == Validity::Unknown, L"Converse must not be valid!" );
+
+         //Three variables
+         Assert::IsTrue( CheckValidity<Implies<And<Implies<A, B>, Implies<B, C>>, Implies<A, C>>, A, B, C>() == Validity::Always, L"Transitivity not valid!" );
+         Assert::IsTrue( CheckValidity<And<A, And<Not<A>, Or<B, C>>>, A, B, C>() == Validity::Never, L"Contradiction with three variables not detected!" );
+         Assert::IsTrue( CheckValidity<Equals<And<Implies<A, B>, Implies<B, C>>, Implies<A, C>>, A, B, C>() == Validity::Unknown, L"Equivalence must not be valid!" );
+      }
+
+      TEST_METHOD( TestCheckValidityAllAssignments )
+      {
+         //Each formula differs from the others only for a single assignment of the three variables, so each
+         //assignment has to be checked
+         Assert::IsTrue( CheckValidity<And<Not<A>, And<B, Not<C>>>, A, B, C>() == Validity::Unknown, L"Assignment false, true, false not checked!" );
+         Assert::IsTrue( CheckValidity<And<Not<A>, And<Not<B>, C>>, A, B, C>() == Validity::Unknown, L"Assignment false, false, true not checked!" );
+         Assert::IsTrue( CheckValidity<Or<Not<A>, Or<Not<B>, C>>, A, B, C>() == Validity::Unknown, L"Assignment true, true, false not checked!" );
+      }
+	};
+}
@@ -0,0 +1,105 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "Sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ThinkingCode_Test
+{
+	TEST_CLASS(SketchesTest)
+	{
+	public:
+
+      TEST_METHOD( TestHyperLogLog )
+      {
+         Sketches::HyperLogLog empty;
+         Assert::IsTrue( empty.Estimate() == 0, L"Empty sketch must estimate zero!" );
+
+         //Small counts are nearly exact, duplicates don't count
+         Sketches::HyperLogLog small;
+         for ( int round = 0; round < 3; round++ )
+         {
+            for ( uint64_t i = 0; i < 100; i++ ) small.Add( i );
+         }
+         Assert::IsTrue( std::abs( small.Estimate() - 100 ) <= 2, L"Small count not estimated!" );
+
+         //Sequential hashes are mixed, so they must not skew large counts
+         Sketches::HyperLogLog large;
+         for ( uint64_t i = 0; i < 1000000; i++ ) large.Add( i );
+         Assert::IsTrue( std::abs( large.Estimate() - 1000000 ) < 50000, L"Large count not estimated!" );
+
+         //Merging two halves gives the same registers as adding everything to one sketch
+         Sketches::HyperLogLog first;
+         Sketches::HyperLogLog second;
+         for ( uint64_t i = 0; i < 1000000; i++ ) ( i % 2 ? first : second ).Add( i );
+         second.Add( 0 );
+         first.Merge( second );
+         Assert::IsTrue( first.Estimate() == large.Estimate(), L"Merge not working!" );
+
+         bool thrown = false;
+         try
+         {
+            first.Merge( Sketches::HyperLogLog( 10 ) );
+         }
+         catch ( const std::exception& )
+         {
+            thrown = true;
+         }
+         Assert::IsTrue( thrown, L"Merging different precisions must fail!" );
+      }
+
+      TEST_METHOD( TestQuantileSketch )
+      {
+         //Until k elements are added, quantiles are exact
+         Sketches::QuantileSketch<int> exact( 100 );
+         for ( int i = 100; i > 0; i-- ) exact.Add( i );
+         Assert::IsTrue( exact.Quantile( 0 ) == 1 && exact.Quantile( 0.5 ) == 50 && exact.Quantile( 1 ) == 100, L"Small sketch must be exact!" );
+         Assert::IsTrue( exact.Rank( 25 ) == 0.25, L"Rank not working!" );
+
+         //Larger streams are approximated within about 1% of the rank
+         const int count = 1000000;
+         Sketches::QuantileSketch<int> sketch;
+         Sketches::QuantileSketch<int> first;
+         Sketches::QuantileSketch<int> second;
+         for ( int i = 0; i < count; i++ )
+         {
+            int val = static_cast<int>( ( i * 7919LL ) % count );
+            sketch.Add( val );
+            ( val < count / 2 ? first : second ).Add( val );
+         }
+         first.Merge( second );
+
+         bool accurate = true;
+         for ( double fraction : { 0.01, 0.1, 0.5, 0.9, 0.99 } )
+         {
+            accurate = accurate && std::abs( sketch.Quantile( fraction ) - fraction * count ) < 0.02 * count;
+            accurate = accurate && std::abs( first.Quantile( fraction ) - fraction * count ) < 0.02 * count;
+            accurate = accurate && std::abs( sketch.Rank( static_cast<int>( fraction * count ) ) - fraction ) < 0.02;
+         }
+         Assert::IsTrue( accurate, L"Quantiles not accurate!" );
+         Assert::IsTrue( sketch.Count() == count && first.Count() == count, L"Wrong count!" );
+         Assert::IsTrue( sketch.Quantile( 0 ) >= 0 && sketch.Quantile( 1 ) < count, L"Quantile outside of the stream!" );
+
+         //Any ordered type
+         Sketches::QuantileSketch<std::string, std::greater<std::string>> words;
+         for ( auto word : { "b", "a", "c" } ) words.Add( word );
+         Assert::IsTrue( words.Quantile( 0 ) == "c", L"Custom order not working!" );
+
+         bool thrown = false;
+         try
+         {
+            Sketches::QuantileSketch<int>().Quantile( 0.5 );
+         }
+         catch ( const std::exception& )
+         {
+            thrown = true;
+         }
+         Assert::IsTrue( thrown, L"Quantile of empty sketch must fail!" );
+      }
+	};
+}
@@ -0,0 +1,84 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "SpscQueue.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ThinkingCode_Test
+{
+	TEST_CLASS(SpscQueueTest)
+	{
+	public:
+
+      TEST_METHOD( TestSingleThread )
+      {
+         Threading::SpscQueue<std::string> queue( 3 );
+         Assert::IsTrue( queue.Capacity() == 4, L"Capacity not rounded up!" );
+         Assert::IsTrue( queue.Front() == nullptr, L"New queue must be empty!" );
+
+         //Wrap around the ring buffer a few times
+         int next = 0;
+         for ( int round = 0; round < 10; round++ )
+         {
+            for ( int i = 0; i < 3; i++ ) Assert::IsTrue( queue.TryPush( std::to_string( round * 3 + i ) ), L"Push failed!" );
+            for ( int i = 0; i < 3; i++ )
+            {
+               Assert::IsTrue( queue.Front() != nullptr && *queue.Front() == std::to_string( next++ ), L"Wrong order!" );
+               queue.Pop();
+            }
+         }
+
+         for ( int i = 0; i < 4; i++ ) Assert::IsTrue( queue.TryPush( std::string( "x" ) ), L"Push failed!" );
+         std::string rejected( "rejected" );
+         Assert::IsFalse( queue.TryPush( std::move( rejected ) ), L"Push into full queue must fail!" );
+         Assert::IsTrue( rejected == "rejected", L"Rejected element must not be moved from!" );
+
+         //Remaining elements are destroyed with the queue
+         auto shared = std::make_shared<int>( 1 );
+         {
+            Threading::SpscQueue<std::shared_ptr<int>> owners( 2 );
+            owners.TryPush( shared );
+            owners.TryPush( shared );
+            Assert::IsTrue( shared.use_count() == 3, L"Elements not created!" );
+         }
+         Assert::IsTrue( shared.use_count() == 1, L"Elements not destroyed!" );
+      }
+
+      TEST_METHOD( TestTwoThreads )
+      {
+         const int count = 100000;
+         Threading::SpscQueue<int> queue( 64 );
+
+         std::thread producer( [&queue, count] ()
+         {
+            for ( int i = 0; i < count; i++ )
+            {
+               while ( !queue.TryPush( i ) ) std::this_thread::yield();
+            }
+         } );
+
+         bool ordered = true;
+         for ( int expected = 0; expected < count; )
+         {
+            if ( auto front = queue.Front() )
+            {
+               ordered = ordered && *front == expected++;
+               queue.Pop();
+            }
+            else
+            {
+               std::this_thread::yield();
+            }
+         }
+         producer.join();
+
+         Assert::IsTrue( ordered, L"Elements not received in order!" );
+         Assert::IsTrue( queue.Front() == nullptr, L"Queue must be empty!" );
+      }
+	};
+}